@@ -0,0 +1,580 @@
+#include <golos/chain/account_history_store.hpp>
+#include <golos/protocol/config.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#define HISTORY_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+
+namespace golos {
+    namespace chain {
+
+        namespace bip = boost::interprocess;
+
+        namespace detail {
+
+            /// name of the account padded with zeros, names are compared as bytes
+            using account_key = std::array<char, STEEMIT_MAX_ACCOUNT_NAME_LENGTH>;
+
+            struct segment_header {
+                uint32_t accounts = 0;
+                uint32_t last_block = 0;
+                uint64_t entries = 0;
+                uint32_t blocks = 0;
+                uint32_t first_block = 0;
+            };
+
+            struct segment_account {
+                account_key name;
+                uint32_t first_sequence = 0;
+                uint32_t count = 0;
+                uint64_t first_entry = 0;
+            };
+
+            /// the first record of the block in the data file
+            struct segment_block {
+                uint32_t block = 0;
+                uint32_t reserved = 0;
+                uint64_t offset = 0;
+            };
+
+            static_assert(sizeof(segment_header) == 24, "segment_header is written to the index as is");
+            static_assert(sizeof(segment_account) == 32, "segment_account is written to the index as is");
+            static_assert(sizeof(segment_block) == 16, "segment_block is written to the index as is");
+
+            static account_key make_key(const account_name_type &account) {
+                std::string name = account;
+                account_key key;
+                key.fill(0);
+                FC_ASSERT(name.size() <= key.size(), "Account name ${a} is too long", ("a", name));
+                std::memcpy(key.data(), name.data(), name.size());
+                return key;
+            }
+
+            static bool key_less(const account_key &a, const account_key &b) {
+                return std::memcmp(a.data(), b.data(), a.size()) < 0;
+            }
+
+            struct account_key_less {
+                bool operator()(const account_key &a, const account_key &b) const {
+                    return key_less(a, b);
+                }
+            };
+
+            /**
+             * Read-only mapping of a segment file
+             */
+            class mapped_segment_file final {
+            public:
+                mapped_segment_file(const fc::path &path)
+                        : _file(path.generic_string().c_str(), bip::read_only),
+                          _region(_file, bip::read_only) {
+                }
+
+                const char *data() const {
+                    return static_cast<const char *>(_region.get_address());
+                }
+
+                uint64_t size() const {
+                    return _region.get_size();
+                }
+
+            private:
+                bip::file_mapping _file;
+                bip::mapped_region _region;
+            };
+
+            struct sealed_segment {
+                uint32_t number = 0;
+                std::unique_ptr<mapped_segment_file> data;
+                std::unique_ptr<mapped_segment_file> index;
+
+                const segment_header &header() const {
+                    return *reinterpret_cast<const segment_header *>(index->data());
+                }
+
+                const segment_account *accounts_begin() const {
+                    return reinterpret_cast<const segment_account *>(index->data() + sizeof(segment_header));
+                }
+
+                const segment_account *accounts_end() const {
+                    return accounts_begin() + header().accounts;
+                }
+
+                const uint64_t *offsets() const {
+                    return reinterpret_cast<const uint64_t *>(accounts_end());
+                }
+
+                const segment_block *blocks_begin() const {
+                    return reinterpret_cast<const segment_block *>(offsets() + header().entries);
+                }
+
+                const segment_block *blocks_end() const {
+                    return blocks_begin() + header().blocks;
+                }
+
+                const segment_account *find(const account_key &key) const {
+                    auto itr = std::lower_bound(accounts_begin(), accounts_end(), key,
+                        [](const segment_account &a, const account_key &k) { return key_less(a.name, k); });
+                    if (itr == accounts_end() || key_less(key, itr->name)) {
+                        return nullptr;
+                    }
+                    return itr;
+                }
+            };
+
+            struct active_account {
+                uint32_t first_sequence = 0;
+                std::vector<uint64_t> offsets;
+            };
+
+            class account_history_store_impl final {
+            public:
+                account_history_store_impl(uint32_t segment_size)
+                        : segment_size(segment_size) {
+                    active_stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                }
+
+                fc::path segment_file(uint32_t number, const char *extension) const {
+                    char name[32];
+                    snprintf(name, sizeof(name), "history-%08u%s", number, extension);
+                    return dir / name;
+                }
+
+                void open_sealed(uint32_t number) {
+                    sealed_segment segment;
+                    segment.number = number;
+                    segment.data.reset(new mapped_segment_file(segment_file(number, ".ops")));
+                    segment.index.reset(new mapped_segment_file(segment_file(number, ".idx")));
+
+                    FC_ASSERT(segment.index->size() >= sizeof(segment_header), "Index of segment ${n} is corrupted", ("n", number));
+                    const auto &header = segment.header();
+                    FC_ASSERT(segment.index->size() ==
+                        sizeof(segment_header) + header.accounts * sizeof(segment_account) +
+                        header.entries * sizeof(uint64_t) + header.blocks * sizeof(segment_block),
+                        "Index of segment ${n} is corrupted", ("n", number));
+
+                    for (auto itr = segment.accounts_begin(); itr != segment.accounts_end(); ++itr) {
+                        account_sizes[itr->name] = itr->first_sequence + itr->count;
+                    }
+                    head_block = header.last_block;
+                    sealed.push_back(std::move(segment));
+                }
+
+                void open_active(uint32_t number) {
+                    active_number = number;
+                    active_accounts.clear();
+                    active_blocks.clear();
+                    active_entries = 0;
+                    active_size = 0;
+                    active_data.reset();
+
+                    auto path = segment_file(number, ".ops");
+                    uint64_t size = fc::exists(path) ? fc::file_size(path) : 0;
+                    if (size) {
+                        active_size = load_active(path, size);
+                        if (active_size < size) {
+                            wlog("Account history segment ${n} has an incomplete record at the end, truncate it from ${s} to ${p} bytes",
+                                 ("n", number)("s", size)("p", active_size));
+                            boost::filesystem::resize_file(path, active_size);
+                        }
+                    }
+
+                    active_stream.open(path.generic_string().c_str(), HISTORY_WRITE);
+                    remap_active();
+                }
+
+                /**
+                 * @return size of the complete records of the data file which blocks are not after block_num
+                 */
+                static uint64_t records_up_to(const fc::path &path, uint64_t size, uint32_t block_num) {
+                    mapped_segment_file data(path);
+                    uint64_t pos = 0;
+                    while (pos + sizeof(uint32_t) <= size) {
+                        uint32_t record_size;
+                        std::memcpy(&record_size, data.data() + pos, sizeof(record_size));
+                        if (pos + sizeof(uint32_t) + record_size > size || read(data, pos).block > block_num) {
+                            break;
+                        }
+                        pos += sizeof(uint32_t) + record_size;
+                    }
+                    return pos;
+                }
+
+                /**
+                 * Rebuild the index of the active segment from its data file
+                 *
+                 * @return size of the complete records
+                 */
+                uint64_t load_active(const fc::path &path, uint64_t size) {
+                    mapped_segment_file data(path);
+                    account_history_record record;
+                    uint64_t pos = 0;
+                    while (pos + sizeof(uint32_t) <= size) {
+                        uint32_t record_size;
+                        std::memcpy(&record_size, data.data() + pos, sizeof(record_size));
+                        if (pos + sizeof(uint32_t) + record_size > size) {
+                            break;
+                        }
+                        fc::datastream<const char *> ds(data.data() + pos + sizeof(uint32_t), record_size);
+                        fc::raw::unpack(ds, record);
+                        add_active(record, pos);
+                        pos += sizeof(uint32_t) + record_size;
+                    }
+                    return pos;
+                }
+
+                void add_active(const account_history_record &record, uint64_t offset) {
+                    for (const auto &item : record.accounts) {
+                        auto key = make_key(item.first);
+                        auto &account_size = account_sizes[key];
+                        FC_ASSERT(item.second == account_size, "Account history of ${a} is not continuous",
+                                  ("a", item.first)("sequence", item.second)("expected", account_size));
+
+                        auto &account = active_accounts[key];
+                        if (account.offsets.empty()) {
+                            account.first_sequence = item.second;
+                        }
+                        account.offsets.push_back(offset);
+                        account_size = item.second + 1;
+                        ++active_entries;
+                    }
+                    if (active_blocks.empty() || active_blocks.back().block != record.block) {
+                        segment_block block;
+                        block.block = record.block;
+                        block.offset = offset;
+                        active_blocks.push_back(block);
+                    }
+                    head_block = record.block;
+                }
+
+                void remap_active() {
+                    if (active_size && (!active_data || active_data->size() < active_size)) {
+                        active_data.reset(new mapped_segment_file(segment_file(active_number, ".ops")));
+                    }
+                }
+
+                void seal() {
+                    active_stream.flush();
+                    active_stream.close();
+
+                    segment_header header;
+                    header.accounts = active_accounts.size();
+                    header.last_block = head_block;
+                    header.entries = active_entries;
+                    header.blocks = active_blocks.size();
+                    header.first_block = active_blocks.empty() ? 0 : active_blocks.front().block;
+
+                    auto tmp_path = segment_file(active_number, ".idx.tmp");
+                    {
+                        std::ofstream index(tmp_path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+                        index.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                        index.write((const char *)&header, sizeof(header));
+
+                        uint64_t first_entry = 0;
+                        for (const auto &item : active_accounts) {
+                            segment_account account;
+                            account.name = item.first;
+                            account.first_sequence = item.second.first_sequence;
+                            account.count = item.second.offsets.size();
+                            account.first_entry = first_entry;
+                            index.write((const char *)&account, sizeof(account));
+                            first_entry += account.count;
+                        }
+                        for (const auto &item : active_accounts) {
+                            index.write((const char *)item.second.offsets.data(), item.second.offsets.size() * sizeof(uint64_t));
+                        }
+                        index.write((const char *)active_blocks.data(), active_blocks.size() * sizeof(segment_block));
+                    }
+                    // the index appears at once, a segment without it is still the active one
+                    fc::rename(tmp_path, segment_file(active_number, ".idx"));
+
+                    ilog("Account history segment ${n} is sealed: ${e} entries of ${a} accounts up to block ${b}",
+                         ("n", active_number)("e", active_entries)("a", header.accounts)("b", head_block));
+
+                    open_sealed(active_number);
+                    open_active(active_number + 1);
+                }
+
+                /**
+                 * Visit records of the block, they follow each other from the first one
+                 */
+                template<typename Visitor>
+                static void visit_block(
+                    const mapped_segment_file &data, const segment_block *begin, const segment_block *end,
+                    uint32_t block_num, Visitor &&visitor
+                ) {
+                    auto itr = std::lower_bound(begin, end, block_num,
+                        [](const segment_block &b, uint32_t n) { return b.block < n; });
+                    if (itr == end || itr->block != block_num) {
+                        return;
+                    }
+                    for (uint64_t offset = itr->offset; offset < data.size();) {
+                        auto record = read(data, offset, &offset);
+                        if (record.block != block_num) {
+                            return;
+                        }
+                        visitor(record);
+                    }
+                }
+
+                /**
+                 * @param next set to the offset of the next record
+                 */
+                static account_history_record read(const mapped_segment_file &data, uint64_t offset, uint64_t *next = nullptr) {
+                    FC_ASSERT(offset + sizeof(uint32_t) <= data.size(), "Attempt to read past the end of the account history segment");
+                    uint32_t record_size;
+                    std::memcpy(&record_size, data.data() + offset, sizeof(record_size));
+                    FC_ASSERT(offset + sizeof(uint32_t) + record_size <= data.size(), "Attempt to read past the end of the account history segment");
+
+                    account_history_record record;
+                    fc::datastream<const char *> ds(data.data() + offset + sizeof(uint32_t), record_size);
+                    fc::raw::unpack(ds, record);
+                    if (next) {
+                        *next = offset + sizeof(uint32_t) + record_size;
+                    }
+                    return record;
+                }
+
+                const uint32_t segment_size;
+                fc::path dir;
+                uint32_t head_block = 0;
+
+                std::vector<sealed_segment> sealed;
+
+                uint32_t active_number = 0;
+                std::ofstream active_stream;
+                std::unique_ptr<mapped_segment_file> active_data;
+                uint64_t active_size = 0;
+                uint64_t active_entries = 0;
+                std::map<account_key, active_account, account_key_less> active_accounts;
+                std::vector<segment_block> active_blocks;
+
+                /// number of operations of each account in the store
+                std::map<account_key, uint32_t, account_key_less> account_sizes;
+            };
+        }
+
+        account_history_store::account_history_store(uint32_t segment_size)
+                : my(new detail::account_history_store_impl(segment_size)) {
+            FC_ASSERT(segment_size > 0, "Segment size of the account history store should be positive");
+        }
+
+        account_history_store::~account_history_store() {
+            close();
+        }
+
+        void account_history_store::open(const fc::path &dir) {
+            close();
+            my->dir = dir;
+            fc::create_directories(dir);
+
+            std::vector<uint32_t> numbers;
+            for (boost::filesystem::directory_iterator itr(dir), end; itr != end; ++itr) {
+                auto name = itr->path().filename().string();
+                if (name.size() == 20 && name.compare(0, 8, "history-") == 0 && name.compare(16, 4, ".ops") == 0) {
+                    numbers.push_back(std::stoul(name.substr(8, 8)));
+                }
+            }
+            std::sort(numbers.begin(), numbers.end());
+
+            uint32_t active_number = 0;
+            for (auto number : numbers) {
+                if (!fc::exists(my->segment_file(number, ".idx"))) {
+                    FC_ASSERT(number == numbers.back(), "Account history segment ${n} has no index", ("n", number));
+                    active_number = number;
+                    break;
+                }
+                my->open_sealed(number);
+                active_number = number + 1;
+            }
+            my->open_active(active_number);
+
+            ilog("Account history store is opened: ${s} full segments, ${a} accounts, head block ${b}",
+                 ("s", my->sealed.size())("a", my->account_sizes.size())("b", my->head_block));
+        }
+
+        void account_history_store::close() {
+            if (my->active_stream.is_open()) {
+                my->active_stream.flush();
+                my->active_stream.close();
+            }
+            my->active_data.reset();
+            my->active_accounts.clear();
+            my->active_blocks.clear();
+            my->active_entries = 0;
+            my->active_size = 0;
+            my->sealed.clear();
+            my->account_sizes.clear();
+            my->head_block = 0;
+        }
+
+        void account_history_store::wipe() {
+            auto dir = my->dir;
+            close();
+            if (fc::exists(dir)) {
+                for (boost::filesystem::directory_iterator itr(dir), end; itr != end; ++itr) {
+                    if (itr->path().filename().string().compare(0, 8, "history-") == 0) {
+                        fc::remove(itr->path());
+                    }
+                }
+            }
+            open(dir);
+        }
+
+        void account_history_store::truncate(uint32_t block_num) {
+            if (block_num >= my->head_block) {
+                return;
+            }
+
+            std::vector<uint32_t> numbers;
+            for (const auto &segment : my->sealed) {
+                numbers.push_back(segment.number);
+            }
+            numbers.push_back(my->active_number);
+
+            auto dir = my->dir;
+            close();
+
+            // records are in the order of blocks, segments are cut from the newest one until a kept record is met
+            for (auto itr = numbers.rbegin(); itr != numbers.rend(); ++itr) {
+                auto data_path = my->segment_file(*itr, ".ops");
+                auto index_path = my->segment_file(*itr, ".idx");
+                uint64_t size = fc::exists(data_path) ? fc::file_size(data_path) : 0;
+                uint64_t keep = size ? my->records_up_to(data_path, size, block_num) : 0;
+                if (size && keep == size) {
+                    break;
+                }
+
+                // the segment becomes the active one or is removed
+                if (fc::exists(index_path)) {
+                    fc::remove(index_path);
+                }
+                if (keep) {
+                    boost::filesystem::resize_file(data_path, keep);
+                    break;
+                }
+                if (fc::exists(data_path)) {
+                    fc::remove(data_path);
+                }
+            }
+
+            open(dir);
+            ilog("Account history store is truncated to block ${b}", ("b", block_num));
+        }
+
+        void account_history_store::append(const account_history_record &record) {
+            try {
+                FC_ASSERT(my->active_stream.is_open(), "Account history store is not opened");
+                FC_ASSERT(record.block >= my->head_block, "Account history should be appended in the order of blocks",
+                          ("head", my->head_block)("block", record.block));
+
+                for (const auto &item : record.accounts) {
+                    FC_ASSERT(item.second == get_account_size(item.first), "Account history of ${a} is not continuous",
+                              ("a", item.first)("sequence", item.second)("expected", get_account_size(item.first)));
+                }
+
+                auto data = fc::raw::pack(record);
+                uint32_t record_size = data.size();
+                my->active_stream.write((const char *)&record_size, sizeof(record_size));
+                my->active_stream.write(data.data(), data.size());
+
+                my->add_active(record, my->active_size);
+                my->active_size += sizeof(record_size) + record_size;
+
+                if (my->active_entries >= my->segment_size) {
+                    my->seal();
+                }
+            }
+            FC_CAPTURE_AND_RETHROW((record.block))
+        }
+
+        void account_history_store::flush() {
+            if (my->active_stream.is_open()) {
+                my->active_stream.flush();
+            }
+            my->remap_active();
+        }
+
+        uint32_t account_history_store::head_block() const {
+            return my->head_block;
+        }
+
+        uint32_t account_history_store::get_account_size(const account_name_type &account) const {
+            auto itr = my->account_sizes.find(detail::make_key(account));
+            return itr != my->account_sizes.end() ? itr->second : 0;
+        }
+
+        void account_history_store::get_block_history(uint32_t block_num, record_visitor_type visitor) const {
+            // records of a block can go on in the next segment
+            for (const auto &segment : my->sealed) {
+                const auto &header = segment.header();
+                if (header.last_block < block_num) {
+                    continue;
+                }
+                if (header.first_block > block_num) {
+                    return;
+                }
+                my->visit_block(*segment.data, segment.blocks_begin(), segment.blocks_end(), block_num, visitor);
+            }
+
+            if (!my->active_blocks.empty()) {
+                FC_ASSERT(my->active_data, "Account history store is not flushed");
+                my->visit_block(*my->active_data, my->active_blocks.data(),
+                                my->active_blocks.data() + my->active_blocks.size(), block_num, visitor);
+            }
+        }
+
+        void account_history_store::get_history(
+            const account_name_type &account, uint32_t first, uint32_t last, visitor_type visitor
+        ) const {
+            if (first > last) {
+                return;
+            }
+
+            auto key = detail::make_key(account);
+            int64_t next = last;
+
+            // segments hold sequences of an account in the ascending order, so they are read from the newest one
+            auto visit = [&](const detail::mapped_segment_file &data, uint32_t first_sequence, uint32_t count,
+                const uint64_t *offsets
+            ) {
+                int64_t lowest = std::max<int64_t>(first, first_sequence);
+                for (int64_t seq = std::min<int64_t>(next, int64_t(first_sequence) + count - 1); seq >= lowest; --seq) {
+                    visitor(uint32_t(seq), my->read(data, offsets[seq - first_sequence]));
+                }
+                next = std::min<int64_t>(next, lowest - 1);
+                return first_sequence <= first;
+            };
+
+            auto active = my->active_accounts.find(key);
+            if (active != my->active_accounts.end()) {
+                FC_ASSERT(my->active_data, "Account history store is not flushed");
+                if (visit(*my->active_data, active->second.first_sequence, active->second.offsets.size(),
+                          active->second.offsets.data())) {
+                    return;
+                }
+            }
+
+            for (auto itr = my->sealed.rbegin(); itr != my->sealed.rend() && next >= first; ++itr) {
+                auto segment_account = itr->find(key);
+                if (segment_account &&
+                    visit(*itr->data, segment_account->first_sequence, segment_account->count,
+                          itr->offsets() + segment_account->first_entry)) {
+                    return;
+                }
+            }
+        }
+
+    }
+} // golos::chain
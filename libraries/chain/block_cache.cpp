@@ -0,0 +1,141 @@
+#include <golos/chain/block_cache.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <mutex>
+
+namespace golos {
+    namespace chain {
+
+        namespace detail {
+            using namespace boost::multi_index;
+
+            struct block_cache_entry {
+                block_id_type id;
+                uint32_t num = 0;
+                bool irreversible = false;
+                std::shared_ptr<const signed_block> block;
+            };
+
+            struct by_id;
+            struct by_num;
+
+            typedef multi_index_container<
+                block_cache_entry,
+                indexed_by<
+                    sequenced<>,
+                    hashed_unique<tag<by_id>,
+                        member<block_cache_entry, block_id_type, &block_cache_entry::id>,
+                        std::hash<fc::ripemd160>>,
+                    hashed_non_unique<tag<by_num>,
+                        member<block_cache_entry, uint32_t, &block_cache_entry::num>>>
+            > block_cache_index;
+
+            class block_cache_impl {
+            public:
+                mutable std::mutex mutex;
+                block_cache_index entries;
+                uint32_t max_size = block_cache::default_max_size;
+
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+
+                void shrink(uint32_t size) {
+                    while (entries.size() > size) {
+                        entries.pop_back();
+                    }
+                }
+
+                template<typename Iterator>
+                std::shared_ptr<const signed_block> hit(Iterator itr) {
+                    entries.relocate(entries.begin(), entries.project<0>(itr));
+                    ++hits;
+                    return itr->block;
+                }
+            };
+        }
+
+        block_cache::block_cache(uint32_t max_size)
+                : my(new detail::block_cache_impl()) {
+            my->max_size = max_size;
+        }
+
+        block_cache::~block_cache() {
+        }
+
+        void block_cache::set_max_size(uint32_t max_size) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            my->max_size = max_size;
+            my->shrink(max_size);
+        }
+
+        void block_cache::store(std::shared_ptr<const signed_block> block, bool irreversible) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            if (my->max_size == 0) {
+                return;
+            }
+
+            auto id = block->id();
+            auto &idx = my->entries.get<detail::by_id>();
+            auto itr = idx.find(id);
+            if (itr != idx.end()) {
+                idx.modify(itr, [&](detail::block_cache_entry &e) {
+                    e.irreversible = e.irreversible || irreversible;
+                });
+                my->entries.relocate(my->entries.begin(), my->entries.project<0>(itr));
+                return;
+            }
+
+            detail::block_cache_entry entry;
+            entry.id = id;
+            entry.num = block->block_num();
+            entry.irreversible = irreversible;
+            entry.block = std::move(block);
+            my->entries.push_front(std::move(entry));
+            my->shrink(my->max_size);
+        }
+
+        std::shared_ptr<const signed_block> block_cache::find(const block_id_type &id) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            auto &idx = my->entries.get<detail::by_id>();
+            auto itr = idx.find(id);
+            if (itr == idx.end()) {
+                ++my->misses;
+                return std::shared_ptr<const signed_block>();
+            }
+            return my->hit(itr);
+        }
+
+        std::shared_ptr<const signed_block> block_cache::find_irreversible(uint32_t block_num) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            auto &idx = my->entries.get<detail::by_num>();
+            auto range = idx.equal_range(block_num);
+            for (auto itr = range.first; itr != range.second; ++itr) {
+                if (itr->irreversible) {
+                    return my->hit(itr);
+                }
+            }
+            ++my->misses;
+            return std::shared_ptr<const signed_block>();
+        }
+
+        void block_cache::clear() {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            my->entries.clear();
+        }
+
+        block_cache_stats block_cache::get_stats() const {
+            block_cache_stats stats;
+            std::lock_guard<std::mutex> lock(my->mutex);
+            stats.hits = my->hits;
+            stats.misses = my->misses;
+            stats.size = my->entries.size();
+            stats.max_size = my->max_size;
+            return stats;
+        }
+
+    }
+} // golos::chain
@@ -1,67 +1,108 @@
 #include <golos/chain/block_log.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <mutex>
 
-#define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
 namespace golos {
     namespace chain {
 
+        namespace bip = boost::interprocess;
+
         namespace detail {
+            /**
+             * Read-only mapping of a log file. A mapping covers the file as it was at the moment
+             * of mapping, it is replaced by a bigger one when a reader asks for data appended later.
+             * Readers hold a shared_ptr to the mapping, so an old mapping stays valid until the
+             * last reader which uses it is done.
+             */
+            class mapped_log_file final {
+            public:
+                mapped_log_file(const fc::path &path)
+                        : _file(path.generic_string().c_str(), bip::read_only),
+                          _region(_file, bip::read_only) {
+                }
+
+                const char *data() const {
+                    return static_cast<const char *>(_region.get_address());
+                }
+
+                uint64_t size() const {
+                    return _region.get_size();
+                }
+
+            private:
+                bip::file_mapping _file;
+                bip::mapped_region _region;
+            };
+
+            using mapped_log_file_ptr = std::shared_ptr<const mapped_log_file>;
+
             class block_log_impl {
             public:
                 optional<signed_block> head;
-                block_id_type head_id;
-                std::fstream block_stream;
-                std::fstream index_stream;
+                std::atomic<uint32_t> head_num{0};
+                std::ofstream block_stream;
+                std::ofstream index_stream;
                 fc::path block_file;
                 fc::path index_file;
-                bool block_write;
-                bool index_write;
+                mapped_log_file_ptr block_mapping;
+                mapped_log_file_ptr index_mapping;
+                // serializes appends and remapping, readers never take it while the mapping is big enough
                 std::mutex mutex;
 
-                inline void check_block_read() {
-                    if (block_write) {
-                        block_stream.close();
-                        block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-                        block_write = false;
-                    }
+                block_log_impl() {
+                    block_stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                    index_stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
                 }
 
-                inline void check_block_write() {
-                    if (!block_write) {
-                        block_stream.close();
-                        block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-                        block_write = true;
+                mapped_log_file_ptr get_mapping(mapped_log_file_ptr &mapping, const fc::path &file, uint64_t min_size) {
+                    auto result = std::atomic_load(&mapping);
+                    if (result && result->size() >= min_size) {
+                        return result;
                     }
-                }
 
-                inline void check_index_read() {
-                    try {
-                        if (index_write) {
-                            index_stream.close();
-                            index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                            index_write = false;
-                        }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    result = std::atomic_load(&mapping);
+                    if (!result || result->size() < min_size) {
+                        FC_ASSERT(fc::file_size(file) >= min_size,
+                                  "Attempt to read past the end of ${file}",
+                                  ("file", file)("size", fc::file_size(file))("required", min_size));
+                        result = std::make_shared<const mapped_log_file>(file);
+                        std::atomic_store(&mapping, result);
                     }
-                    FC_LOG_AND_RETHROW()
+                    return result;
                 }
 
-                inline void check_index_write() {
-                    if (!index_write) {
-                        index_stream.close();
-                        index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-                        index_write = true;
-                    }
+                mapped_log_file_ptr get_block_mapping(uint64_t min_size) {
+                    return get_mapping(block_mapping, block_file, min_size);
+                }
+
+                mapped_log_file_ptr get_index_mapping(uint64_t min_size) {
+                    return get_mapping(index_mapping, index_file, min_size);
+                }
+
+                void reset_mappings() {
+                    std::atomic_store(&block_mapping, mapped_log_file_ptr());
+                    std::atomic_store(&index_mapping, mapped_log_file_ptr());
+                }
+
+                static uint64_t read_last_pos(const mapped_log_file &mapping) {
+                    uint64_t pos;
+                    std::memcpy(&pos, mapping.data() + mapping.size() - sizeof(pos), sizeof(pos));
+                    return pos;
                 }
             };
         }
 
         block_log::block_log()
                 : my(new detail::block_log_impl()) {
-            my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
-            my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
         }
 
         block_log::~block_log() {
@@ -75,14 +116,13 @@ namespace golos {
             if (my->index_stream.is_open()) {
                 my->index_stream.close();
             }
+            my->reset_mappings();
 
             my->block_file = file;
             my->index_file = fc::path(file.generic_string() + ".index");
 
             my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
             my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-            my->block_write = true;
-            my->index_write = true;
 
             /* On startup of the block log, there are several states the log file and the index file can be
              * in relation to eachother.
@@ -108,20 +148,12 @@ namespace golos {
             if (log_size) {
                 ilog("Log is nonempty");
                 my->head = read_head();
-                my->head_id = my->head->id();
+                my->head_num = my->head->block_num();
 
                 if (index_size) {
-                    my->check_block_read();
-                    my->check_index_read();
-
                     ilog("Index is nonempty");
-                    uint64_t block_pos;
-                    my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-                    my->block_stream.read((char *)&block_pos, sizeof(block_pos));
-
-                    uint64_t index_pos;
-                    my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-                    my->index_stream.read((char *)&index_pos, sizeof(index_pos));
+                    uint64_t block_pos = my->read_last_pos(*my->get_block_mapping(log_size));
+                    uint64_t index_pos = my->read_last_pos(*my->get_index_mapping(index_size));
 
                     if (block_pos < index_pos) {
                         ilog("block_pos < index_pos, close and reopen index_stream");
@@ -139,7 +171,6 @@ namespace golos {
                 my->index_stream.close();
                 fc::remove_all(my->index_file);
                 my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-                my->index_write = true;
             }
         }
 
@@ -157,8 +188,6 @@ namespace golos {
                 uint64_t pos;
                 {
                     std::lock_guard<std::mutex> lock(my->mutex);
-                    my->check_block_write();
-                    my->check_index_write();
 
                     FC_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b.block_num() - 1),
                               "Append to index file occuring at wrong position.",
@@ -169,8 +198,14 @@ namespace golos {
                     my->block_stream.write(data.data(), data.size());
                     my->block_stream.write((char *) &pos, sizeof(pos));
                     my->index_stream.write((char *) &pos, sizeof(pos));
+
+                    // readers see the file through a mapping, so the new block should reach the file
+                    // before it becomes visible via head
+                    my->block_stream.flush();
+                    my->index_stream.flush();
+
                     my->head = b;
-                    my->head_id = b.id();
+                    my->head_num = b.block_num();
                 }
 
                 return pos;
@@ -179,19 +214,25 @@ namespace golos {
         }
 
         void block_log::flush() {
-            my->block_stream.flush();
-            my->index_stream.flush();
+            std::lock_guard<std::mutex> lock(my->mutex);
+            if (my->block_stream.is_open()) {
+                my->block_stream.flush();
+            }
+            if (my->index_stream.is_open()) {
+                my->index_stream.flush();
+            }
         }
 
         std::pair<signed_block, uint64_t> block_log::read_block(uint64_t pos) const {
             std::pair<signed_block, uint64_t> result;
-            {
-                std::lock_guard<std::mutex> lock(my->mutex);
-                my->check_block_read();
-                my->block_stream.seekg(pos);
-                fc::raw::unpack(my->block_stream, result.first);
-                result.second = uint64_t(my->block_stream.tellg()) + 8;
-            }
+
+            auto mapping = my->get_block_mapping(pos + sizeof(uint64_t));
+
+            // unpack straight from the mapped memory, without copying the record into a stream buffer
+            fc::datastream<const char *> ds(mapping->data() + pos, mapping->size() - pos);
+            fc::raw::unpack(ds, result.first);
+            result.second = pos + ds.tellp() + sizeof(uint64_t);
+
             return result;
         }
 
@@ -212,33 +253,19 @@ namespace golos {
         }
 
         uint64_t block_log::get_block_pos(uint32_t block_num) const {
-            uint64_t pos;
-            {
-                std::lock_guard<std::mutex> lock(my->mutex);
-
-                if (!(my->head.valid() &&
-                      block_num <= protocol::block_header::num_from_id(my->head_id) &&
-                      block_num > 0)
-                ) {
-                    return npos;
-                }
-
-                my->check_index_read();
-                my->index_stream.seekg(sizeof(uint64_t) * (block_num - 1));
-                my->index_stream.read((char *) &pos, sizeof(pos));
+            if (!(block_num <= my->head_num && block_num > 0)) {
+                return npos;
             }
+
+            uint64_t pos;
+            auto mapping = my->get_index_mapping(sizeof(uint64_t) * block_num);
+            std::memcpy(&pos, mapping->data() + sizeof(uint64_t) * (block_num - 1), sizeof(pos));
             return pos;
         }
 
         signed_block block_log::read_head() const {
-            uint64_t pos;
-            {
-                std::lock_guard<std::mutex> lock(my->mutex);
-                my->check_block_read();
-
-                my->block_stream.seekg(-sizeof(pos), std::ios::end);
-                my->block_stream.read((char *) &pos, sizeof(pos));
-            }
+            auto size = fc::file_size(my->block_file);
+            auto pos = my->read_last_pos(*my->get_block_mapping(size));
             return read_block(pos).first;
         }
 
@@ -250,24 +277,22 @@ namespace golos {
             ilog("Reconstructing Block Log Index...");
             my->index_stream.close();
             fc::remove_all(my->index_file);
+            std::atomic_store(&my->index_mapping, detail::mapped_log_file_ptr());
             my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-            my->index_write = true;
 
-            uint64_t pos = 0;
-            uint64_t end_pos;
-            my->check_block_read();
+            auto mapping = my->get_block_mapping(fc::file_size(my->block_file));
+            uint64_t end_pos = my->read_last_pos(*mapping);
 
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char *)&end_pos, sizeof(end_pos));
+            fc::datastream<const char *> ds(mapping->data(), mapping->size());
             signed_block tmp;
-
-            my->block_stream.seekg(pos);
+            uint64_t pos = 0;
 
             while (pos < end_pos) {
-                fc::raw::unpack(my->block_stream, tmp);
-                my->block_stream.read((char *)&pos, sizeof(pos));
+                fc::raw::unpack(ds, tmp);
+                ds.read((char *)&pos, sizeof(pos));
                 my->index_stream.write((char *)&pos, sizeof(pos));
             }
+            my->index_stream.flush();
         }
     }
 }
@@ -0,0 +1,185 @@
+#include <golos/chain/block_profiler.hpp>
+
+#include <golos/protocol/operations.hpp>
+#include <golos/protocol/operation_util_impl.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace golos {
+    namespace chain {
+
+        void profile_histogram::add(uint64_t time) {
+            profile_counter::add(time);
+
+            if (buckets.empty()) {
+                buckets.resize(bucket_count);
+            }
+
+            uint32_t bucket = 0;
+            while (bucket + 1 < bucket_count && time >= (uint64_t(1) << bucket)) {
+                ++bucket;
+            }
+            ++buckets[bucket];
+        }
+
+        block_profiler::block_profiler()
+                : _operations(protocol::operation::count()) {
+        }
+
+        void block_profiler::add_block(const fc::microseconds &time) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _blocks.add(time.count());
+        }
+
+        void block_profiler::add_stage(stage_type stage, const fc::microseconds &time) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stages[stage].add(time.count());
+        }
+
+        void block_profiler::add_operation(int operation_type, const fc::microseconds &time) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _operations[operation_type].add(time.count());
+        }
+
+        void block_profiler::add_signal(signal_type signal, const fc::microseconds &time) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _signals[signal].add(time.count());
+        }
+
+        void block_profiler::add_fork_switch(const fork_switch_profile &fork_switch) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _fork_switches.add(fork_switch.total_time);
+            if (fork_switch.undone_blocks > _max_fork_switch_depth) {
+                _max_fork_switch_depth = fork_switch.undone_blocks;
+            }
+            _recent_fork_switches.push_back(fork_switch);
+            if (_recent_fork_switches.size() > recent_fork_switch_count) {
+                _recent_fork_switches.pop_front();
+            }
+        }
+
+        size_t block_profiler::add_signal_handler(signal_type signal, const std::string &plugin) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            signal_handler_profile handler;
+            handler.plugin = plugin;
+            handler.signal = signal_name(signal);
+            _handlers.push_back(handler);
+            return _handlers.size() - 1;
+        }
+
+        void block_profiler::add_signal_handler_call(size_t handler_id, const fc::microseconds &time) {
+            auto threshold = _slow_handler_threshold.load();
+            bool slow = threshold > 0 && time.count() > threshold;
+            std::string signal;
+            std::string plugin;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto &handler = _handlers[handler_id];
+                handler.add(time.count());
+                if (!slow) {
+                    return;
+                }
+                ++handler.slow_count;
+                signal = handler.signal;
+                plugin = handler.plugin;
+            }
+            // logging can block on its appenders, the lock is already released
+            wlog("Slow ${s} handler of plugin ${p}: ${t} us", ("s", signal)("p", plugin)("t", time.count()));
+        }
+
+        void block_profiler::set_slow_handler_threshold(const fc::microseconds &threshold) {
+            _slow_handler_threshold = threshold.count();
+        }
+
+        std::vector<signal_handler_profile> block_profiler::get_signal_handlers() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _handlers;
+        }
+
+        block_profile block_profiler::get_profile() const {
+            block_profile result;
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            result.blocks = _blocks;
+            for (uint32_t i = 0; i < stage_count; ++i) {
+                if (_stages[i].count) {
+                    result.stages[stage_name(stage_type(i))] = _stages[i];
+                }
+            }
+            for (uint32_t i = 0; i < _operations.size(); ++i) {
+                if (_operations[i].count) {
+                    protocol::operation op;
+                    op.set_which(i);
+                    std::string name;
+                    op.visit(fc::get_operation_name(name));
+                    result.operations[name] = _operations[i];
+                }
+            }
+            for (uint32_t i = 0; i < signal_count; ++i) {
+                if (_signals[i].count) {
+                    result.signals[signal_name(signal_type(i))] = _signals[i];
+                }
+            }
+            result.fork_switches = _fork_switches;
+            result.max_fork_switch_depth = _max_fork_switch_depth;
+            result.recent_fork_switches.assign(_recent_fork_switches.begin(), _recent_fork_switches.end());
+            return result;
+        }
+
+        void block_profiler::reset() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _blocks = profile_counter();
+            _stages.fill(profile_counter());
+            _operations.assign(_operations.size(), profile_histogram());
+            _signals.fill(profile_counter());
+            _fork_switches = profile_counter();
+            _max_fork_switch_depth = 0;
+            _recent_fork_switches.clear();
+            for (auto &handler : _handlers) {
+                static_cast<profile_counter &>(handler) = profile_counter();
+                handler.slow_count = 0;
+            }
+        }
+
+        const char *block_profiler::stage_name(stage_type stage) {
+            static const char *names[stage_count] = {
+                "validate_block_header",
+                "apply_transactions",
+                "update_global_dynamic_data",
+                "update_signing_witness",
+                "update_last_irreversible_block",
+                "create_block_summary",
+                "clear_expired_transactions",
+                "clear_expired_orders",
+                "update_witness_schedule",
+                "update_median_feed",
+                "update_virtual_supply",
+                "clear_null_account_balance",
+                "process_funds",
+                "process_conversions",
+                "process_comment_cashout",
+                "process_vesting_withdrawals",
+                "process_savings_withdraws",
+                "pay_liquidity_reward",
+                "update_virtual_supply_after_rewards",
+                "account_recovery_processing",
+                "expire_escrow_ratification",
+                "process_decline_voting_rights",
+                "process_hardforks",
+                "notify_changed_objects"
+            };
+            return names[stage];
+        }
+
+        const char *block_profiler::signal_name(signal_type signal) {
+            static const char *names[signal_count] = {
+                "pre_apply_operation",
+                "post_apply_operation",
+                "applied_block",
+                "on_pending_transaction"
+            };
+            return names[signal];
+        }
+
+    }
+} // golos::chain
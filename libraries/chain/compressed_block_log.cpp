@@ -0,0 +1,283 @@
+#include <golos/chain/compressed_block_log.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+
+namespace golos {
+    namespace chain {
+
+        namespace bip = boost::interprocess;
+
+        namespace detail {
+            const char compressed_block_log_magic[8] = {'G', 'L', 'S', 'B', 'L', 'K', 'V', '2'};
+            const uint32_t compressed_block_log_version = 2;
+
+            enum compression_method : uint32_t {
+                compression_zlib = 1
+            };
+
+            struct compressed_block_log_header {
+                char magic[8];
+                uint32_t version;
+                uint32_t blocks_per_chunk;
+                uint32_t compression;
+                uint32_t reserved;
+            };
+
+            struct compressed_block_log_chunk {
+                uint64_t pos;
+                uint32_t packed_size;
+                uint32_t raw_size;
+            };
+
+            struct compressed_block_log_footer {
+                uint64_t index_pos;
+                uint32_t chunk_count;
+                uint32_t block_count;
+                char magic[8];
+            };
+
+            class compressed_block_log_impl {
+            public:
+                fc::path file;
+
+                // writing
+                std::ofstream out;
+                int compression_level = Z_DEFAULT_COMPRESSION;
+                std::vector<uint32_t> chunk_offsets;
+                std::vector<char> chunk_data;
+                std::vector<compressed_block_log_chunk> index;
+
+                // reading
+                std::unique_ptr<bip::file_mapping> mapping;
+                std::unique_ptr<bip::mapped_region> region;
+                uint64_t index_pos = 0;
+
+                uint32_t blocks_per_chunk = 0;
+                uint32_t block_count = 0;
+                uint32_t chunk_count = 0;
+
+                // the last decompressed chunk
+                mutable std::mutex cache_mutex;
+                mutable uint32_t cached_chunk = std::numeric_limits<uint32_t>::max();
+                mutable std::shared_ptr<const std::vector<char>> cached_data;
+
+                const char *data() const {
+                    return static_cast<const char *>(region->get_address());
+                }
+
+                void write_chunk() {
+                    if (chunk_offsets.empty()) {
+                        return;
+                    }
+
+                    uint32_t table_size = chunk_offsets.size() * sizeof(uint32_t);
+                    std::vector<char> raw(table_size + chunk_data.size());
+                    for (auto &offset : chunk_offsets) {
+                        offset += table_size;
+                    }
+                    std::memcpy(raw.data(), chunk_offsets.data(), table_size);
+                    std::memcpy(raw.data() + table_size, chunk_data.data(), chunk_data.size());
+
+                    uLongf packed_size = compressBound(raw.size());
+                    std::vector<char> packed(packed_size);
+                    auto res = compress2(
+                        reinterpret_cast<Bytef *>(packed.data()), &packed_size,
+                        reinterpret_cast<const Bytef *>(raw.data()), raw.size(), compression_level);
+                    FC_ASSERT(res == Z_OK, "Failed to compress block log chunk", ("error", res));
+
+                    compressed_block_log_chunk chunk;
+                    chunk.pos = out.tellp();
+                    chunk.packed_size = packed_size;
+                    chunk.raw_size = raw.size();
+                    out.write(packed.data(), packed_size);
+                    index.push_back(chunk);
+                    ++chunk_count;
+
+                    chunk_offsets.clear();
+                    chunk_data.clear();
+                }
+
+                std::shared_ptr<const std::vector<char>> read_chunk(uint32_t chunk_num) const {
+                    std::lock_guard<std::mutex> lock(cache_mutex);
+                    if (cached_chunk == chunk_num) {
+                        return cached_data;
+                    }
+
+                    compressed_block_log_chunk chunk;
+                    std::memcpy(&chunk, data() + index_pos + chunk_num * sizeof(chunk), sizeof(chunk));
+                    FC_ASSERT(chunk.pos + chunk.packed_size <= region->get_size(), "Chunk is out of file bounds",
+                              ("chunk", chunk_num)("file", file));
+
+                    auto raw = std::make_shared<std::vector<char>>(chunk.raw_size);
+                    uLongf raw_size = chunk.raw_size;
+                    auto res = uncompress(
+                        reinterpret_cast<Bytef *>(raw->data()), &raw_size,
+                        reinterpret_cast<const Bytef *>(data() + chunk.pos), chunk.packed_size);
+                    FC_ASSERT(res == Z_OK && raw_size == chunk.raw_size, "Failed to decompress block log chunk",
+                              ("chunk", chunk_num)("error", res)("file", file));
+
+                    cached_chunk = chunk_num;
+                    cached_data = raw;
+                    return cached_data;
+                }
+            };
+        }
+
+        compressed_block_log::compressed_block_log()
+                : my(new detail::compressed_block_log_impl()) {
+        }
+
+        compressed_block_log::~compressed_block_log() {
+            try {
+                close();
+            } FC_CAPTURE_AND_LOG(())
+        }
+
+        void compressed_block_log::open(const fc::path &file) {
+            try {
+                close();
+
+                auto file_size = fc::file_size(file);
+                FC_ASSERT(file_size >= sizeof(detail::compressed_block_log_header) + sizeof(detail::compressed_block_log_footer),
+                          "File is too small to be a compressed block log");
+
+                my->file = file;
+                my->mapping.reset(new bip::file_mapping(file.generic_string().c_str(), bip::read_only));
+                my->region.reset(new bip::mapped_region(*my->mapping, bip::read_only));
+
+                detail::compressed_block_log_header header;
+                std::memcpy(&header, my->data(), sizeof(header));
+                FC_ASSERT(std::memcmp(header.magic, detail::compressed_block_log_magic, sizeof(header.magic)) == 0,
+                          "File is not a compressed block log");
+                FC_ASSERT(header.version == detail::compressed_block_log_version, "Unsupported compressed block log version",
+                          ("version", header.version));
+                FC_ASSERT(header.compression == detail::compression_zlib, "Unsupported compression method",
+                          ("compression", header.compression));
+                FC_ASSERT(header.blocks_per_chunk > 0);
+
+                detail::compressed_block_log_footer footer;
+                std::memcpy(&footer, my->data() + file_size - sizeof(footer), sizeof(footer));
+                FC_ASSERT(std::memcmp(footer.magic, detail::compressed_block_log_magic, sizeof(footer.magic)) == 0,
+                          "Compressed block log was not closed properly");
+                FC_ASSERT(footer.index_pos + footer.chunk_count * sizeof(detail::compressed_block_log_chunk) + sizeof(footer) == file_size,
+                          "Compressed block log index is damaged");
+                FC_ASSERT(footer.chunk_count == (footer.block_count + header.blocks_per_chunk - 1) / header.blocks_per_chunk,
+                          "Compressed block log index is damaged");
+
+                my->blocks_per_chunk = header.blocks_per_chunk;
+                my->block_count = footer.block_count;
+                my->chunk_count = footer.chunk_count;
+                my->index_pos = footer.index_pos;
+            } FC_CAPTURE_AND_RETHROW((file))
+        }
+
+        void compressed_block_log::create(const fc::path &file, uint32_t blocks_per_chunk, int compression_level) {
+            try {
+                FC_ASSERT(blocks_per_chunk > 0);
+                close();
+
+                my->file = file;
+                my->blocks_per_chunk = blocks_per_chunk;
+                my->compression_level = compression_level;
+
+                my->out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                my->out.open(file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+                detail::compressed_block_log_header header;
+                std::memcpy(header.magic, detail::compressed_block_log_magic, sizeof(header.magic));
+                header.version = detail::compressed_block_log_version;
+                header.blocks_per_chunk = blocks_per_chunk;
+                header.compression = detail::compression_zlib;
+                header.reserved = 0;
+                my->out.write((const char *)&header, sizeof(header));
+            } FC_CAPTURE_AND_RETHROW((file)(blocks_per_chunk))
+        }
+
+        void compressed_block_log::close() {
+            if (my->out.is_open()) {
+                my->write_chunk();
+
+                detail::compressed_block_log_footer footer;
+                footer.index_pos = my->out.tellp();
+                footer.chunk_count = my->chunk_count;
+                footer.block_count = my->block_count;
+                std::memcpy(footer.magic, detail::compressed_block_log_magic, sizeof(footer.magic));
+
+                my->out.write((const char *)my->index.data(), my->index.size() * sizeof(detail::compressed_block_log_chunk));
+                my->out.write((const char *)&footer, sizeof(footer));
+                my->out.close();
+            }
+
+            my.reset(new detail::compressed_block_log_impl());
+        }
+
+        bool compressed_block_log::is_open() const {
+            return my->out.is_open() || my->region;
+        }
+
+        void compressed_block_log::append(const signed_block &b) {
+            try {
+                FC_ASSERT(my->out.is_open(), "Compressed block log is not opened for writing");
+                FC_ASSERT(b.block_num() == my->block_count + 1, "Blocks should be appended in order",
+                          ("block_num", b.block_num())("expected", my->block_count + 1));
+
+                my->chunk_offsets.push_back(my->chunk_data.size());
+                auto size = fc::raw::pack_size(b);
+                auto offset = my->chunk_data.size();
+                my->chunk_data.resize(offset + size);
+                fc::datastream<char *> ds(my->chunk_data.data() + offset, size);
+                fc::raw::pack(ds, b);
+
+                ++my->block_count;
+                if (my->chunk_offsets.size() == my->blocks_per_chunk) {
+                    my->write_chunk();
+                }
+            } FC_CAPTURE_AND_RETHROW((b.block_num()))
+        }
+
+        optional<signed_block> compressed_block_log::read_block_by_num(uint32_t block_num) const {
+            try {
+                optional<signed_block> b;
+                if (!my->region || block_num == 0 || block_num > my->block_count) {
+                    return b;
+                }
+
+                uint32_t chunk_num = (block_num - 1) / my->blocks_per_chunk;
+                uint32_t in_chunk = (block_num - 1) % my->blocks_per_chunk;
+                auto chunk = my->read_chunk(chunk_num);
+
+                uint32_t offset;
+                FC_ASSERT((in_chunk + 1) * sizeof(offset) <= chunk->size(), "Chunk is damaged", ("chunk", chunk_num));
+                std::memcpy(&offset, chunk->data() + in_chunk * sizeof(offset), sizeof(offset));
+                FC_ASSERT(offset < chunk->size(), "Chunk is damaged", ("chunk", chunk_num));
+
+                fc::datastream<const char *> ds(chunk->data() + offset, chunk->size() - offset);
+                b = signed_block();
+                fc::raw::unpack(ds, *b);
+                FC_ASSERT(b->block_num() == block_num,
+                          "Wrong block was read from compressed block log.",
+                          ("returned", b->block_num())
+                          ("expected", block_num));
+                return b;
+            }
+            FC_LOG_AND_RETHROW()
+        }
+
+        uint32_t compressed_block_log::head_block_num() const {
+            return my->block_count;
+        }
+
+        uint32_t compressed_block_log::blocks_per_chunk() const {
+            return my->blocks_per_chunk;
+        }
+
+    }
+}
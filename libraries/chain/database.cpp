@@ -2,6 +2,7 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include <golos/protocol/signature_cache.hpp>
 #include <golos/protocol/steem_operations.hpp>
 
 #include <golos/chain/block_summary_object.hpp>
@@ -14,6 +15,7 @@
 #include <golos/chain/history_object.hpp>
 #include <golos/chain/index.hpp>
 #include <golos/chain/snapshot_state.hpp>
+#include <golos/chain/state_snapshot.hpp>
 #include <golos/chain/steem_evaluator.hpp>
 #include <golos/chain/steem_objects.hpp>
 #include <golos/chain/transaction_object.hpp>
@@ -27,6 +29,15 @@
 #include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
 
+#include <boost/asio/io_service.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
+
 #define VIRTUAL_SCHEDULE_LAP_LENGTH  ( fc::uint128_t(uint64_t(-1)) )
 #define VIRTUAL_SCHEDULE_LAP_LENGTH2 ( fc::uint128_t::max_value() )
 
@@ -75,16 +86,232 @@ namespace golos {
         public:
             database_impl(database &self);
 
+            ~database_impl();
+
+            void start_signature_workers(uint32_t threads);
+
+            void stop_signature_workers();
+
+            /**
+             * Recover signature keys of the transactions into signature_keys_cache before they are
+             * applied. Transactions are spread across signature workers, if there are no workers
+             * they are recovered on the calling thread.
+             */
+            void recover_signature_keys(const std::vector<signed_transaction> &trxs);
+
+            void start_indexing_thread(indexing_queue &queue, size_t batch_size);
+
+            void stop_indexing_thread(indexing_queue &queue);
+
             database &_self;
             evaluator_registry<operation> _evaluator_registry;
+
+        private:
+            boost::asio::io_service _signature_ios;
+            std::unique_ptr<boost::asio::io_service::work> _signature_work;
+            std::vector<std::thread> _signature_threads;
+
+            std::thread _indexing_thread;
         };
 
         database_impl::database_impl(database &self)
                 : _self(self), _evaluator_registry(self) {
         }
 
+        database_impl::~database_impl() {
+            stop_signature_workers();
+            if (_indexing_thread.joinable()) {
+                _indexing_thread.join();
+            }
+        }
+
+        void database_impl::start_signature_workers(uint32_t threads) {
+            stop_signature_workers();
+
+            _signature_ios.reset();
+            _signature_work.reset(new boost::asio::io_service::work(_signature_ios));
+            for (uint32_t i = 0; i < threads; ++i) {
+                _signature_threads.emplace_back([this]() { _signature_ios.run(); });
+            }
+        }
+
+        void database_impl::stop_signature_workers() {
+            _signature_work.reset();
+            for (auto &thread : _signature_threads) {
+                thread.join();
+            }
+            _signature_threads.clear();
+        }
+
+        void database_impl::start_indexing_thread(indexing_queue &queue, size_t batch_size) {
+            stop_indexing_thread(queue);
+
+            queue.reset();
+            _indexing_thread = std::thread([this, &queue, batch_size]() {
+                while (queue.wait()) {
+                    try {
+                        // one batch per write lock, the lock isn't held for the whole backlog
+                        _self.dispatch_indexing_queue(batch_size);
+                    } FC_CAPTURE_AND_LOG(())
+                }
+            });
+        }
+
+        void database_impl::stop_indexing_thread(indexing_queue &queue) {
+            queue.stop();
+            if (_indexing_thread.joinable()) {
+                _indexing_thread.join();
+            }
+        }
+
+        void database_impl::recover_signature_keys(const std::vector<signed_transaction> &trxs) {
+            auto recover = [](const signed_transaction &trx) {
+                try {
+                    trx.get_signature_keys(STEEMIT_CHAIN_ID);
+                } catch (...) {
+                    // the transaction will fail with a proper error when it is applied
+                }
+            };
+
+            if (!protocol::signature_keys_cache::instance().enabled()) {
+                // nowhere to keep the keys, they will be recovered under the lock anyway
+                return;
+            }
+
+            if (_signature_threads.empty() || trxs.size() < 2) {
+                for (const auto &trx : trxs) {
+                    recover(trx);
+                }
+                return;
+            }
+
+            std::vector<std::future<void>> results;
+            results.reserve(trxs.size());
+            for (const auto &trx : trxs) {
+                auto task = std::make_shared<std::packaged_task<void()>>([&recover, &trx]() {
+                    recover(trx);
+                });
+                results.push_back(task->get_future());
+                _signature_ios.post([task]() { (*task)(); });
+            }
+
+            for (auto &result : results) {
+                result.wait();
+            }
+        }
+
+        namespace detail {
+            /**
+             * Blocks from the block log have been applied once already
+             */
+            const uint32_t replay_skip_flags =
+                    database::skip_witness_signature |
+                    database::skip_transaction_signatures |
+                    database::skip_transaction_dupe_check |
+                    database::skip_tapos_check |
+                    database::skip_merkle_check |
+                    database::skip_witness_schedule_check |
+                    database::skip_authority_check |
+                    database::skip_validate | /// no need to validate operations
+                    database::skip_validate_invariants |
+                    database::skip_block_log;
+
+            /**
+             * Reads blocks from the block log on a background thread and hands them to the
+             * replaying thread in log order. At most max_size unpacked blocks are held in memory.
+             */
+            class block_prefetch_queue final {
+            public:
+                block_prefetch_queue(const block_log &log, uint32_t last_block_num, uint32_t max_size)
+                        : _log(log), _last_block_num(last_block_num), _max_size(std::max<uint32_t>(max_size, 1)) {
+                    _reader = std::thread([this]() { read_blocks(); });
+                }
+
+                ~block_prefetch_queue() {
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _stopped = true;
+                    }
+                    _not_full.notify_all();
+                    _reader.join();
+                }
+
+                /**
+                 * Waits for the next block. Returns false when the whole log has been read,
+                 * rethrows an error raised by the reader thread.
+                 */
+                bool pop(signed_block &block) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _not_empty.wait(lock, [&]() { return !_blocks.empty() || _finished; });
+
+                    if (_blocks.empty()) {
+                        if (_error) {
+                            std::rethrow_exception(_error);
+                        }
+                        return false;
+                    }
+
+                    block = std::move(_blocks.front());
+                    _blocks.pop_front();
+                    lock.unlock();
+
+                    _not_full.notify_one();
+                    return true;
+                }
+
+            private:
+                void read_blocks() {
+                    try {
+                        uint64_t pos = 0;
+                        uint32_t block_num = 0;
+
+                        while (block_num != _last_block_num) {
+                            auto itr = _log.read_block(pos);
+                            block_num = itr.first.block_num();
+                            pos = itr.second;
+
+                            std::unique_lock<std::mutex> lock(_mutex);
+                            _not_full.wait(lock, [&]() { return _blocks.size() < _max_size || _stopped; });
+                            if (_stopped) {
+                                break;
+                            }
+
+                            _blocks.push_back(std::move(itr.first));
+                            lock.unlock();
+
+                            _not_empty.notify_one();
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _error = std::current_exception();
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _finished = true;
+                    }
+                    _not_empty.notify_one();
+                }
+
+                const block_log &_log;
+                const uint32_t _last_block_num;
+                const uint32_t _max_size;
+
+                std::mutex _mutex;
+                std::condition_variable _not_empty;
+                std::condition_variable _not_full;
+                std::deque<signed_block> _blocks;
+                std::exception_ptr _error;
+                bool _finished = false;
+                bool _stopped = false;
+
+                std::thread _reader;
+            };
+        }
+
         database::database()
-                : _my(new database_impl(*this)) {
+                : _my(new database_impl(*this)),
+                  _block_cache(std::make_shared<block_cache>()) {
         }
 
         database::~database() {
@@ -149,38 +376,48 @@ namespace golos {
                 ilog("Replaying blocks...");
 
 
-                uint64_t skip_flags =
-                        skip_witness_signature |
-                        skip_transaction_signatures |
-                        skip_transaction_dupe_check |
-                        skip_tapos_check |
-                        skip_merkle_check |
-                        skip_witness_schedule_check |
-                        skip_authority_check |
-                        skip_validate | /// no need to validate operations
-                        skip_validate_invariants |
-                        skip_block_log;
+                uint64_t skip_flags = detail::replay_skip_flags;
+
+                auto last_block_num = _block_log.head()->block_num();
+                uint64_t total_ops = 0;
 
                 with_write_lock([&]() {
-                    auto itr = _block_log.read_block(0);
-                    auto last_block_num = _block_log.head()->block_num();
+                    // Blocks are read and unpacked on a separate thread, so the only work
+                    // left on this thread is applying them in the order they are in the log.
+                    detail::block_prefetch_queue queue(_block_log, last_block_num, _replay_queue_size);
+
+                    auto interval_start = fc::time_point::now();
+                    uint64_t interval_ops = 0;
+                    signed_block block;
 
-                    while (itr.first.block_num() != last_block_num) {
-                        auto cur_block_num = itr.first.block_num();
+                    while (queue.pop(block)) {
+                        auto cur_block_num = block.block_num();
                         if (cur_block_num % 100000 == 0) {
+                            auto now = fc::time_point::now();
+                            double seconds = std::max(double((now - interval_start).count()) / 1000000.0, 0.000001);
+
                             std::cerr << "   " << double(cur_block_num * 100) /
                                                   last_block_num << "%   "
                                       << cur_block_num << " of "
                                       << last_block_num <<
                                       "   ("
                                       << (get_free_memory() / (1024 * 1024))
-                                      << "M free)\n";
+                                      << "M free, "
+                                      << uint64_t(100000 / seconds) << " blocks/s, "
+                                      << uint64_t(interval_ops / seconds) << " ops/s)\n";
+
+                            interval_start = now;
+                            interval_ops = 0;
                         }
-                        apply_block(itr.first, skip_flags);
-                        itr = _block_log.read_block(itr.second);
+
+                        for (const auto &trx : block.transactions) {
+                            interval_ops += trx.operations.size();
+                            total_ops += trx.operations.size();
+                        }
+
+                        apply_block(block, skip_flags);
                     }
 
-                    apply_block(itr.first, skip_flags);
                     set_revision(head_block_num());
                 });
 
@@ -189,13 +426,135 @@ namespace golos {
                 }
 
                 auto end = fc::time_point::now();
-                ilog("Done reindexing, elapsed time: ${t} sec", ("t",
-                        double((end - start).count()) / 1000000.0));
+                double elapsed = std::max(double((end - start).count()) / 1000000.0, 0.000001);
+                ilog("Done reindexing, elapsed time: ${t} sec, ${b} blocks/s, ${o} ops/s",
+                     ("t", elapsed)
+                     ("b", uint64_t(last_block_num / elapsed))
+                     ("o", uint64_t(total_ops / elapsed)));
             }
             FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir))
 
         }
 
+        void database::export_state(const fc::path &snapshot) {
+            try {
+                ilog("Exporting state to ${f}", ("f", snapshot));
+                auto start = fc::time_point::now();
+                uint64_t objects = 0;
+                uint32_t block_num = 0;
+
+                state_snapshot_writer out(snapshot);
+                with_read_lock([&]() {
+                    state_snapshot_header header;
+                    header.chain_id = get_chain_id();
+                    header.head_block_num = block_num = head_block_num();
+                    header.head_block_id = head_block_id();
+                    header.head_block_time = head_block_time();
+                    header.index_count = _snapshot_indexes.size();
+                    fc::raw::pack(out, header);
+
+                    for (const auto &index : _snapshot_indexes) {
+                        uint64_t count = index->size(*this);
+                        fc::raw::pack(out, index->name());
+                        fc::raw::pack(out, count);
+                        index->write(*this, out);
+                        objects += count;
+                    }
+                });
+                out.finish();
+
+                double elapsed = std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001);
+                ilog("Exported ${o} objects at block ${b} in ${t} sec: ${r} objects/s, ${s} MB/s uncompressed, "
+                     "${c} MB file",
+                     ("o", objects)("b", block_num)("t", elapsed)("r", uint64_t(objects / elapsed))
+                     ("s", uint64_t(out.raw_size() / elapsed / (1024 * 1024)))("c", out.file_size() / (1024 * 1024)));
+            }
+            FC_CAPTURE_AND_RETHROW((snapshot))
+        }
+
+        void database::import_state(
+            const fc::path &data_dir, const fc::path &shared_mem_dir, uint64_t shared_file_size, const fc::path &snapshot
+        ) {
+            try {
+                ilog("Importing state from ${f}", ("f", snapshot));
+                auto start = fc::time_point::now();
+                uint64_t objects = 0;
+
+                wipe(data_dir, shared_mem_dir, false);
+                init_schema();
+                chainbase::database::open(shared_mem_dir, chainbase::database::read_write, shared_file_size);
+                initialize_indexes();
+
+                state_snapshot_reader in(snapshot);
+                with_write_lock([&]() {
+                    state_snapshot_header header;
+                    fc::raw::unpack(in, header);
+                    FC_ASSERT(header.chain_id == get_chain_id(), "State snapshot is made for another chain",
+                              ("chain_id", header.chain_id));
+
+                    std::map<std::string, std::shared_ptr<state_snapshot_index>> indexes;
+                    for (const auto &index : _snapshot_indexes) {
+                        indexes[index->name()] = index;
+                    }
+
+                    for (uint32_t i = 0; i < header.index_count; ++i) {
+                        std::string name;
+                        uint64_t count = 0;
+                        fc::raw::unpack(in, name);
+                        fc::raw::unpack(in, count);
+
+                        auto itr = indexes.find(name);
+                        FC_ASSERT(itr != indexes.end(),
+                                  "State snapshot has objects of ${n}, enable the plugin which they belong to", ("n", name));
+                        itr->second->read(*this, in, count);
+                        indexes.erase(itr);
+                        objects += count;
+                    }
+                    in.finish();
+
+                    for (const auto &index : indexes) {
+                        wlog("State snapshot has no objects of ${n}", ("n", index.first));
+                    }
+
+                    FC_ASSERT(head_block_num() == header.head_block_num && head_block_id() == header.head_block_id,
+                              "Imported state doesn't match the head block of the snapshot");
+                    set_revision(head_block_num());
+                });
+
+                double elapsed = std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001);
+                ilog("Imported ${o} objects at block ${b} in ${t} sec: ${r} objects/s, ${s} MB/s uncompressed",
+                     ("o", objects)("b", head_block_num())("t", elapsed)("r", uint64_t(objects / elapsed))
+                     ("s", uint64_t(in.raw_size() / elapsed / (1024 * 1024))));
+
+                chainbase::database::flush();
+                chainbase::database::close();
+
+                // from here it is a regular state, open() checks that the block log has its head block
+                open(data_dir, shared_mem_dir, STEEMIT_INIT_SUPPLY, shared_file_size, chainbase::database::read_write);
+
+                auto log_head = _block_log.head();
+                if (log_head && log_head->block_num() > head_block_num()) {
+                    auto last_block_num = log_head->block_num();
+                    ilog("Applying blocks ${f}...${l} from block log", ("f", head_block_num() + 1)("l", last_block_num));
+                    with_write_lock([&]() {
+                        for (auto block_num = head_block_num() + 1; block_num <= last_block_num; ++block_num) {
+                            auto block = _block_log.read_block_by_num(block_num);
+                            FC_ASSERT(block.valid(), "Block log doesn't have block ${n}", ("n", block_num));
+                            apply_block(*block, detail::replay_skip_flags);
+                        }
+                        set_revision(head_block_num());
+                    });
+                    _fork_db.reset();
+                    _fork_db.start_block(*log_head);
+                }
+            }
+            FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir)(snapshot))
+        }
+
+        void database::register_snapshot_index(std::shared_ptr<state_snapshot_index> index) {
+            _snapshot_indexes.push_back(std::move(index));
+        }
+
         void database::wipe(const fc::path &data_dir, const fc::path &shared_mem_dir, bool include_blocks) {
             close();
             chainbase::database::wipe(shared_mem_dir);
@@ -259,7 +618,7 @@ namespace golos {
 
                 // Next we query the block log.   Irreversible blocks are here.
 
-                auto b = _block_log.read_block_by_num(block_num);
+                auto b = read_block_from_log(block_num);
                 if (b.valid()) {
                     return b->id();
                 }
@@ -284,18 +643,18 @@ namespace golos {
         optional<signed_block> database::fetch_block_by_id(const block_id_type &id) const {
             try {
                 auto b = _fork_db.fetch_block(id);
-                if (!b) {
-                    auto tmp = _block_log.read_block_by_num(protocol::block_header::num_from_id(id));
+                if (b) {
+                    return *b->data();
+                }
 
-                    if (tmp && tmp->id() == id) {
-                        return tmp;
-                    }
+                auto tmp = read_block_from_log(protocol::block_header::num_from_id(id));
 
-                    tmp.reset();
+                if (tmp && tmp->id() == id) {
                     return tmp;
                 }
 
-                return b->data;
+                tmp.reset();
+                return tmp;
             } FC_CAPTURE_AND_RETHROW()
         }
 
@@ -305,15 +664,28 @@ namespace golos {
 
                 auto results = _fork_db.fetch_block_by_number(block_num);
                 if (results.size() == 1) {
-                    b = results[0]->data;
+                    b = *results[0]->data();
                 } else {
-                    b = _block_log.read_block_by_num(block_num);
+                    b = read_block_from_log(block_num);
                 }
 
                 return b;
             } FC_LOG_AND_RETHROW()
         }
 
+        optional<signed_block> database::read_block_from_log(uint32_t block_num) const {
+            auto cached = _block_cache->find_irreversible(block_num);
+            if (cached) {
+                return *cached;
+            }
+
+            auto b = _block_log.read_block_by_num(block_num);
+            if (b) {
+                _block_cache->store(std::make_shared<const signed_block>(*b), true);
+            }
+            return b;
+        }
+
         const signed_transaction database::get_recent_transaction(const transaction_id_type &trx_id) const {
             try {
                 auto &index = get_index<transaction_index>().indices().get<by_trx_id>();
@@ -627,15 +999,38 @@ namespace golos {
         bool database::push_block(const signed_block &new_block, uint32_t skip) {
             //fc::time_point begin_time = fc::time_point::now();
 
+            // Signature keys are recovered into signature_keys_cache on signature workers before
+            //   the write lock is taken, so under the lock _apply_transaction only checks authorities.
+            if (!(skip & (skip_transaction_signatures | skip_authority_check)) &&
+                !(_checkpoints.size() && _checkpoints.rbegin()->first >= new_block.block_num())) {
+                _my->recover_signature_keys(new_block.transactions);
+            }
+
+            auto prevalidate_start = fc::time_point::now();
+            auto checks = prevalidate_fork(new_block, skip);
+            auto prevalidate_time = fc::time_point::now() - prevalidate_start;
+
             bool result;
             detail::with_skip_flags(*this, skip, [&]() {
                 with_write_lock([&]() {
-                    detail::without_pending_transactions(*this, std::move(_pending_tx), [&]() {
+                    for (const auto &check : checks) {
+                        check.item->merkle_checked = check.merkle_checked;
+                        check.item->signee = check.signee;
+                    }
+                    _fork_prevalidate_time = checks.empty() ? fc::microseconds() : prevalidate_time;
+
+                    auto push = [&]() {
                         try {
                             result = _push_block(new_block);
                         }
                         FC_CAPTURE_AND_RETHROW((new_block))
-                    });
+                    };
+
+                    if (_incremental_pending) {
+                        detail::with_postponed_pending_transactions(*this, std::move(_pending_tx), push);
+                    } else {
+                        detail::without_pending_transactions(*this, std::move(_pending_tx), push);
+                    }
                 });
             });
 
@@ -646,12 +1041,68 @@ namespace golos {
             return result;
         }
 
+        std::vector<database::fork_checks> database::prevalidate_fork(const signed_block &new_block, uint32_t skip) {
+            std::vector<fork_checks> result;
+            std::vector<std::shared_ptr<const signed_block>> bodies;
+
+            if (skip & skip_fork_db) {
+                return result;
+            }
+
+            with_read_lock([&]() {
+                if (new_block.previous == head_block_id() || new_block.block_num() <= head_block_num()) {
+                    return;
+                }
+
+                auto prev = _fork_db.fetch_block(new_block.previous);
+                if (!prev) {
+                    return;
+                }
+
+                try {
+                    auto branches = _fork_db.fetch_branch_from(prev->id, head_block_id());
+                    for (const auto &item : branches.first) {
+                        if (!item->merkle_checked && !item->signee) {
+                            fork_checks check;
+                            check.item = item;
+                            result.push_back(std::move(check));
+                            bodies.push_back(item->data());
+                        }
+                    }
+                } catch (const fc::exception &) {
+                    // the switch will fail under the lock with a proper error
+                    result.clear();
+                    bodies.clear();
+                }
+            });
+
+            bool recover_signatures = !(skip & (skip_transaction_signatures | skip_authority_check));
+            for (size_t i = 0; i < result.size(); ++i) {
+                const auto &body = *bodies[i];
+                if (recover_signatures) {
+                    _my->recover_signature_keys(body.transactions);
+                }
+                if (!(skip & skip_merkle_check)) {
+                    result[i].merkle_checked = (body.calculate_merkle_root() == body.transaction_merkle_root);
+                }
+                if (!(skip & skip_witness_signature)) {
+                    try {
+                        result[i].signee = public_key_type(body.signee());
+                    } catch (const fc::exception &) {
+                        // the block will be checked again under the lock
+                    }
+                }
+            }
+
+            return result;
+        }
+
         void database::_maybe_warn_multiple_production(uint32_t height) const {
             auto blocks = _fork_db.fetch_block_by_number(height);
             if (blocks.size() > 1) {
                 vector<std::pair<account_name_type, fc::time_point_sec>> witness_time_pairs;
                 for (const auto &b : blocks) {
-                    witness_time_pairs.push_back(std::make_pair(b->data.witness, b->data.timestamp));
+                    witness_time_pairs.push_back(std::make_pair(b->block->witness, b->block->timestamp));
                 }
 
                 ilog("Encountered block num collision at block ${n} due to a fork, witnesses are:", ("n", height)("w", witness_time_pairs));
@@ -668,28 +1119,69 @@ namespace golos {
                     shared_ptr<fork_item> new_head = _fork_db.push_block(new_block);
                     _maybe_warn_multiple_production(new_head->num);
                     //If the head block from the longest chain does not build off of the current head, we need to switch forks.
-                    if (new_head->data.previous != head_block_id()) {
+                    if (new_head->previous_id() != head_block_id()) {
                         //If the newly pushed block is the same height as head, we get head back in new_head
                         //Only switch forks if new_head is actually higher than head
-                        if (new_head->data.block_num() > head_block_num()) {
-                            // wlog( "Switching to fork: ${id}", ("id",new_head->data.id()) );
-                            auto branches = _fork_db.fetch_branch_from(new_head->data.id(), head_block_id());
+                        if (new_head->num > head_block_num()) {
+                            // wlog( "Switching to fork: ${id}", ("id",new_head->id) );
+                            auto switch_start = fc::time_point::now();
+                            fork_switch_profile fork_switch;
+                            fork_switch.new_head_num = new_head->num;
+                            fork_switch.prevalidate_time = _fork_prevalidate_time.count();
+
+                            auto finish_switch = [&]() {
+                                fork_switch.total_time = (fc::time_point::now() - switch_start).count();
+                                _profiler.add_fork_switch(fork_switch);
+                                uint64_t undo_time = 0;
+                                uint64_t apply_time = 0;
+                                for (auto t : fork_switch.undo_times) {
+                                    undo_time += t;
+                                }
+                                for (auto t : fork_switch.apply_times) {
+                                    apply_time += t;
+                                }
+                                ilog("${r} fork at block ${n}: ${u} blocks undone in ${ut} us, ${a} blocks applied in ${at} us, "
+                                     "${t} us under lock, ${p} us of checks before lock",
+                                     ("r", fork_switch.failed ? "Failed to switch to" : "Switched to")
+                                     ("n", fork_switch.new_head_num)("u", fork_switch.undone_blocks)("ut", undo_time)
+                                     ("a", fork_switch.applied_blocks)("at", apply_time)("t", fork_switch.total_time)
+                                     ("p", fork_switch.prevalidate_time));
+                            };
+
+                            auto branches = _fork_db.fetch_branch_from(new_head->id, head_block_id());
 
                             // pop blocks until we hit the forked block
                             while (head_block_id() !=
-                                   branches.second.back()->data.previous) {
+                                   branches.second.back()->previous_id()) {
+                                auto pop_start = fc::time_point::now();
                                 pop_block();
+                                fork_switch.undo_times.push_back((fc::time_point::now() - pop_start).count());
                             }
+                            fork_switch.undone_blocks = fork_switch.undo_times.size();
 
                             // push all blocks on the new fork
                             for (auto ritr = branches.first.rbegin();
                                  ritr != branches.first.rend(); ++ritr) {
-                                // ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->data.block_num())("id",(*ritr)->data.id()) );
+                                // ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->num)("id",(*ritr)->id) );
                                 optional<fc::exception> except;
                                 try {
+                                    auto apply_start = fc::time_point::now();
+                                    const auto &body = (*ritr)->data();
+
+                                    // checks made by prevalidate_fork() aren't repeated under the lock
+                                    uint32_t block_skip = skip;
+                                    if ((*ritr)->merkle_checked) {
+                                        block_skip |= skip_merkle_check;
+                                    }
+                                    if ((*ritr)->signee && *(*ritr)->signee == get_witness(body->witness).signing_key) {
+                                        block_skip |= skip_witness_signature;
+                                    }
+
                                     auto session = start_undo_session(true);
-                                    apply_block((*ritr)->data, skip);
+                                    apply_block(*body, block_skip);
                                     session.push();
+                                    fork_switch.apply_times.push_back((fc::time_point::now() - apply_start).count());
+                                    ++fork_switch.applied_blocks;
                                 }
                                 catch (const fc::exception &e) {
                                     except = e;
@@ -698,14 +1190,14 @@ namespace golos {
                                     // wlog( "exception thrown while switching forks ${e}", ("e",except->to_detail_string() ) );
                                     // remove the rest of branches.first from the fork_db, those blocks are invalid
                                     while (ritr != branches.first.rend()) {
-                                        _fork_db.remove((*ritr)->data.id());
+                                        _fork_db.remove((*ritr)->id);
                                         ++ritr;
                                     }
                                     _fork_db.set_head(branches.second.front());
 
                                     // pop all blocks from the bad fork
                                     while (head_block_id() !=
-                                           branches.second.back()->data.previous) {
+                                           branches.second.back()->previous_id()) {
                                         pop_block();
                                     }
 
@@ -714,12 +1206,16 @@ namespace golos {
                                          ritr !=
                                          branches.second.rend(); ++ritr) {
                                         auto session = start_undo_session(true);
-                                        apply_block((*ritr)->data, skip);
+                                        apply_block(*(*ritr)->data(), skip);
                                         session.push();
                                     }
+                                    fork_switch.failed = true;
+                                    finish_switch();
                                     throw *except;
                                 }
                             }
+
+                            finish_switch();
                             return true;
                         } else {
                             return false;
@@ -757,6 +1253,17 @@ namespace golos {
                     FC_ASSERT(fc::raw::pack_size(trx) <=
                               (get_dynamic_global_properties().maximum_block_size -
                                256));
+                    if (!(skip & (skip_transaction_signatures | skip_authority_check)) &&
+                        protocol::signature_keys_cache::instance().enabled()
+                    ) {
+                        // recover keys into signature_keys_cache out of the write lock
+                        try {
+                            trx.get_signature_keys(STEEMIT_CHAIN_ID);
+                        } catch (...) {
+                            // the transaction will fail with a proper error when it is applied
+                        }
+                    }
+
                     set_producing(true);
                     detail::with_skip_flags(*this, skip,
                             [&]() {
@@ -854,9 +1361,20 @@ namespace golos {
                 _pending_tx_session.reset();
                 _pending_tx_session = start_undo_session(true);
 
+                // transactions postponed in the incremental pending mode are validated here as well
+                std::vector<const signed_transaction *> candidates;
+                candidates.reserve(_pending_tx.size() + _postponed_tx.size());
+                for (const auto &tx : _pending_tx) {
+                    candidates.push_back(&tx);
+                }
+                for (const auto &tx : _postponed_tx) {
+                    candidates.push_back(&tx);
+                }
+
                 uint64_t postponed_tx_count = 0;
                 // pop pending state (reset to head block state)
-                for (const signed_transaction &tx : _pending_tx) {
+                for (const signed_transaction *candidate : candidates) {
+                    const signed_transaction &tx = *candidate;
                     // Only include transactions that have not expired yet for currently generating block,
                     // this should clear problem transactions and allow block production to continue
 
@@ -957,6 +1475,7 @@ namespace golos {
             try {
                 _pending_tx_session.reset();
                 auto head_id = head_block_id();
+                auto head_num = head_block_num();
 
                 /// save the head block so we can recover its transactions
                 optional<signed_block> head_block = fetch_block_by_id(head_id);
@@ -965,6 +1484,10 @@ namespace golos {
                 _fork_db.pop_block();
                 undo();
 
+                if (_indexing_queue.has_handlers()) {
+                    _indexing_queue.pop_block(head_num);
+                }
+
                 _popped_tx.insert(_popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end());
 
             }
@@ -976,22 +1499,57 @@ namespace golos {
                 assert((_pending_tx.size() == 0) ||
                        _pending_tx_session.valid());
                 _pending_tx.clear();
+                _postponed_tx.clear();
                 _pending_tx_session.reset();
             }
             FC_CAPTURE_AND_RETHROW()
         }
 
+        size_t database::apply_postponed_transactions(fc::microseconds max_time) {
+            size_t result = 0;
+            with_write_lock([&]() {
+                auto deadline = fc::time_point::now() + max_time;
+                auto now = head_block_time();
+                while (!_postponed_tx.empty() && fc::time_point::now() < deadline) {
+                    auto tx = std::move(_postponed_tx.front());
+                    _postponed_tx.pop_front();
+                    try {
+                        if (tx.expiration > now && !is_known_transaction(tx.id())) {
+                            // since push_transaction() takes a signed_transaction,
+                            // the operation_results field will be ignored.
+                            _push_transaction(tx);
+                        }
+                    } catch (const fc::exception &) {
+                    }
+                }
+                result = _postponed_tx.size();
+            });
+            return result;
+        }
+
         void database::notify_pre_apply_operation(operation_notification &note) {
             note.trx_id = _current_trx_id;
             note.block = _current_block_num;
             note.trx_in_block = _current_trx_in_block;
             note.op_in_trx = _current_op_in_trx;
 
-            STEEMIT_TRY_NOTIFY(pre_apply_operation, note)
+            _profiler.measure(block_profiler::pre_apply_operation_signal, [&]() {
+                STEEMIT_TRY_NOTIFY(pre_apply_operation, note)
+            });
+
+            if (_indexing_queue.has_operation_handlers()) {
+                _indexing_queue.add_operation(false, note, head_block_time());
+            }
         }
 
         void database::notify_post_apply_operation(const operation_notification &note) {
-            STEEMIT_TRY_NOTIFY(post_apply_operation, note)
+            _profiler.measure(block_profiler::post_apply_operation_signal, [&]() {
+                STEEMIT_TRY_NOTIFY(post_apply_operation, note)
+            });
+
+            if (_indexing_queue.has_operation_handlers()) {
+                _indexing_queue.add_operation(true, note, head_block_time());
+            }
         }
 
         inline const void database::push_virtual_operation(const operation &op, bool force) {
@@ -1008,11 +1566,26 @@ namespace golos {
         }
 
         void database::notify_applied_block(const signed_block &block) {
-            STEEMIT_TRY_NOTIFY(applied_block, block)
+            _profiler.measure(block_profiler::applied_block_signal, [&]() {
+                STEEMIT_TRY_NOTIFY(applied_block, block)
+            });
+
+            if (_indexing_queue.has_handlers()) {
+                _indexing_queue.add_block(block);
+                auto size = _indexing_queue.size();
+                if (!_async_indexing_started || size > _async_indexing_queue_size) {
+                    // nobody consumes the queue or it can't keep up, index the excess in the undo session of this block
+                    _indexing_queue.dispatch(block.block_num(),
+                        get_dynamic_global_properties().last_irreversible_block_num,
+                        _async_indexing_started ? size - _async_indexing_queue_size : size);
+                }
+            }
         }
 
         void database::notify_on_pending_transaction(const signed_transaction &tx) {
-            STEEMIT_TRY_NOTIFY(on_pending_transaction, tx)
+            _profiler.measure(block_profiler::on_pending_transaction_signal, [&]() {
+                STEEMIT_TRY_NOTIFY(on_pending_transaction, tx)
+            });
         }
 
         void database::notify_on_applied_transaction(const signed_transaction &tx) {
@@ -2702,6 +3275,7 @@ namespace golos {
         }
 
         void database::initialize_indexes() {
+            _snapshot_indexes.clear();
             add_core_index<dynamic_global_property_index>(*this);
             add_core_index<account_index>(*this);
             add_core_index<account_authority_index>(*this);
@@ -2978,11 +3552,108 @@ namespace golos {
             _next_flush_block = 0;
         }
 
+        void database::set_replay_queue_size(uint32_t blocks) {
+            _replay_queue_size = blocks;
+        }
+
+        void database::set_signature_recovery_threads(uint32_t threads) {
+            _my->start_signature_workers(threads);
+        }
+
+        void database::set_incremental_pending(bool value) {
+            _incremental_pending = value;
+        }
+
+        bool database::is_incremental_pending() const {
+            return _incremental_pending;
+        }
+
+        void database::set_block_cache_size(uint32_t blocks) {
+            _block_cache->set_max_size(blocks);
+        }
+
+        block_cache_stats database::get_block_cache_stats() const {
+            return _block_cache->get_stats();
+        }
+
+        void database::set_account_history_store(std::shared_ptr<account_history_store> store) {
+            _account_history_store = std::move(store);
+        }
+
+        const std::shared_ptr<account_history_store> &database::get_account_history_store() const {
+            return _account_history_store;
+        }
+
+        void database::set_async_indexing(
+            const std::set<std::string> &plugins, uint32_t max_queue_size, uint32_t batch_size
+        ) {
+            FC_ASSERT(batch_size > 0, "Batch size of the indexing queue should be positive");
+            _async_indexing_plugins = plugins;
+            _async_indexing_queue_size = max_queue_size;
+            _async_indexing_batch_size = batch_size;
+        }
+
+        void database::allow_async_indexing(const std::string &plugin) {
+            _async_indexing_allowed.insert(plugin);
+        }
+
+        bool database::is_async_indexing(const std::string &plugin) const {
+            return _async_indexing_plugins.count(plugin) != 0 && _async_indexing_allowed.count(plugin) != 0;
+        }
+
+        time_point_sec database::notification_time() const {
+            const auto &time = _indexing_queue.notification_time();
+            return time.valid() ? *time : head_block_time();
+        }
+
+        void database::start_async_indexing() {
+            for (const auto &plugin : _async_indexing_plugins) {
+                // handlers of other plugins read the state of the notified block, later it is gone
+                FC_ASSERT(_async_indexing_allowed.count(plugin),
+                          "Plugin ${p} isn't enabled or doesn't support asynchronous indexing", ("p", plugin));
+            }
+            if (!_indexing_queue.has_handlers()) {
+                return;
+            }
+            _my->start_indexing_thread(_indexing_queue, _async_indexing_batch_size);
+            _async_indexing_started = true;
+        }
+
+        void database::stop_async_indexing() {
+            if (!_async_indexing_started) {
+                return;
+            }
+            _async_indexing_started = false;
+            _my->stop_indexing_thread(_indexing_queue);
+            while (dispatch_indexing_queue(_async_indexing_batch_size)) {
+            }
+        }
+
+        size_t database::dispatch_indexing_queue(size_t max_blocks) {
+            size_t result = 0;
+            with_write_lock([&]() {
+                if (!_indexing_queue.size()) {
+                    return;
+                }
+                auto dispatch = [&]() {
+                    result = _indexing_queue.dispatch(head_block_num(),
+                        get_dynamic_global_properties().last_irreversible_block_num, max_blocks);
+                };
+                // writes of handlers must go to the undo session of the head block, not to the pending one
+                if (_incremental_pending) {
+                    detail::with_postponed_pending_transactions(*this, std::move(_pending_tx), dispatch);
+                } else {
+                    detail::without_pending_transactions(*this, std::move(_pending_tx), dispatch);
+                }
+            });
+            return result;
+        }
+
 //////////////////// private methods ////////////////////
 
         void database::apply_block(const signed_block &next_block, uint32_t skip) {
             try {
-                //fc::time_point begin_time = fc::time_point::now();
+                fc::time_point begin_time = fc::time_point::now();
 
                 auto block_num = next_block.block_num();
                 if (_checkpoints.size() &&
@@ -3020,8 +3691,10 @@ namespace golos {
    }
    FC_CAPTURE_AND_RETHROW( (next_block) );*/
 
-                //fc::time_point end_time = fc::time_point::now();
-                //fc::microseconds dt = end_time - begin_time;
+                if (_profiler.enabled()) {
+                    _profiler.add_block(fc::time_point::now() - begin_time);
+                }
+
                 if (_flush_blocks != 0) {
                     if (_next_flush_block == 0) {
                         uint32_t lep = block_num + 1 + _flush_blocks * 9 / 10;
@@ -3063,6 +3736,11 @@ namespace golos {
 
                 uint32_t skip = get_node_properties().skip_flags;
 
+                // operations of pending transactions are not indexed asynchronously
+                if (_indexing_queue.has_operation_handlers()) {
+                    _indexing_queue.discard_operations();
+                }
+
                 if (!(skip & skip_merkle_check)) {
                     auto merkle_root = next_block.calculate_merkle_root();
 
@@ -3081,7 +3759,11 @@ namespace golos {
                     }
                 }
 
+                auto header_start = fc::time_point::now();
                 const witness_object &signing_witness = validate_block_header(skip, next_block);
+                if (_profiler.enabled()) {
+                    _profiler.add_stage(block_profiler::validate_block_header_stage, fc::time_point::now() - header_start);
+                }
 
                 _current_block_num = next_block_num;
                 _current_trx_in_block = 0;
@@ -3113,49 +3795,57 @@ namespace golos {
                     );
                 }
 
-                for (const auto &trx : next_block.transactions) {
-                    /* We do not need to push the undo state for each transaction
-                     * because they either all apply and are valid or the
-                     * entire block fails to apply.  We only need an "undo" state
-                     * for transactions when validating broadcast transactions or
-                     * when building a block.
-                     */
-                    apply_transaction(trx, skip);
-                    ++_current_trx_in_block;
-                }
+                _profiler.measure(block_profiler::apply_transactions_stage, [&]() {
+                    for (const auto &trx : next_block.transactions) {
+                        /* We do not need to push the undo state for each transaction
+                         * because they either all apply and are valid or the
+                         * entire block fails to apply.  We only need an "undo" state
+                         * for transactions when validating broadcast transactions or
+                         * when building a block.
+                         */
+                        apply_transaction(trx, skip);
+                        ++_current_trx_in_block;
+                    }
+                });
 
-                update_global_dynamic_data(next_block);
-                update_signing_witness(signing_witness, next_block);
+                _profiler.measure(block_profiler::update_global_dynamic_data_stage, [&]() {
+                    update_global_dynamic_data(next_block);
+                });
+                _profiler.measure(block_profiler::update_signing_witness_stage, [&]() {
+                    update_signing_witness(signing_witness, next_block);
+                });
 
-                update_last_irreversible_block();
+                _profiler.measure(block_profiler::update_last_irreversible_block_stage, [&]() {
+                    update_last_irreversible_block();
+                });
 
-                create_block_summary(next_block);
-                clear_expired_transactions();
-                clear_expired_orders();
-                update_witness_schedule();
+                _profiler.measure(block_profiler::create_block_summary_stage, [&]() { create_block_summary(next_block); });
+                _profiler.measure(block_profiler::clear_expired_transactions_stage, [&]() { clear_expired_transactions(); });
+                _profiler.measure(block_profiler::clear_expired_orders_stage, [&]() { clear_expired_orders(); });
+                _profiler.measure(block_profiler::update_witness_schedule_stage, [&]() { update_witness_schedule(); });
 
-                update_median_feed();
-                update_virtual_supply();
+                _profiler.measure(block_profiler::update_median_feed_stage, [&]() { update_median_feed(); });
+                _profiler.measure(block_profiler::update_virtual_supply_stage, [&]() { update_virtual_supply(); });
 
-                clear_null_account_balance();
-                process_funds();
-                process_conversions();
-                process_comment_cashout();
-                process_vesting_withdrawals();
-                process_savings_withdraws();
-                pay_liquidity_reward();
-                update_virtual_supply();
+                _profiler.measure(block_profiler::clear_null_account_balance_stage, [&]() { clear_null_account_balance(); });
+                _profiler.measure(block_profiler::process_funds_stage, [&]() { process_funds(); });
+                _profiler.measure(block_profiler::process_conversions_stage, [&]() { process_conversions(); });
+                _profiler.measure(block_profiler::process_comment_cashout_stage, [&]() { process_comment_cashout(); });
+                _profiler.measure(block_profiler::process_vesting_withdrawals_stage, [&]() { process_vesting_withdrawals(); });
+                _profiler.measure(block_profiler::process_savings_withdraws_stage, [&]() { process_savings_withdraws(); });
+                _profiler.measure(block_profiler::pay_liquidity_reward_stage, [&]() { pay_liquidity_reward(); });
+                _profiler.measure(block_profiler::update_virtual_supply_after_rewards_stage, [&]() { update_virtual_supply(); });
 
-                account_recovery_processing();
-                expire_escrow_ratification();
-                process_decline_voting_rights();
+                _profiler.measure(block_profiler::account_recovery_processing_stage, [&]() { account_recovery_processing(); });
+                _profiler.measure(block_profiler::expire_escrow_ratification_stage, [&]() { expire_escrow_ratification(); });
+                _profiler.measure(block_profiler::process_decline_voting_rights_stage, [&]() { process_decline_voting_rights(); });
 
-                process_hardforks();
+                _profiler.measure(block_profiler::process_hardforks_stage, [&]() { process_hardforks(); });
 
                 // notify observers that the block has been applied
                 notify_applied_block(next_block);
 
-                notify_changed_objects();
+                _profiler.measure(block_profiler::notify_changed_objects_stage, [&]() { notify_changed_objects(); });
             } //FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
             FC_CAPTURE_LOG_AND_RETHROW((next_block.block_num()))
         }
@@ -3384,7 +4074,13 @@ namespace golos {
         void database::apply_operation(const operation &op) {
             operation_notification note(op);
             notify_pre_apply_operation(note);
-            _my->_evaluator_registry.get_evaluator(op).apply(op);
+            if (_profiler.enabled()) {
+                auto start = fc::time_point::now();
+                _my->_evaluator_registry.get_evaluator(op).apply(op);
+                _profiler.add_operation(op.which(), fc::time_point::now() - start);
+            } else {
+                _my->_evaluator_registry.get_evaluator(op).apply(op);
+            }
             notify_post_apply_operation(note);
         }
 
@@ -3640,7 +4336,8 @@ namespace golos {
                             std::shared_ptr<fork_item> block = _fork_db.fetch_block_on_main_branch_by_number(
                                     log_head_num + 1);
                             FC_ASSERT(block, "Current fork in the fork database does not contain the last_irreversible_block");
-                            _block_log.append(block->data);
+                            _block_log.append(*block->data());
+                            _block_cache->store(block->data(), true);
                             log_head_num++;
                         }
 
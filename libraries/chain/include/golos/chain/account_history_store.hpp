@@ -0,0 +1,115 @@
+#pragma once
+
+#include <golos/protocol/operations.hpp>
+#include <golos/chain/steem_object_types.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <functional>
+#include <memory>
+
+namespace golos {
+    namespace chain {
+
+        using golos::protocol::account_name_type;
+        using golos::protocol::transaction_id_type;
+
+        namespace detail { class account_history_store_impl; }
+
+        /**
+         * Operation of the account history with the accounts it is recorded for
+         */
+        struct account_history_record {
+            transaction_id_type trx_id;
+            uint32_t block = 0;
+            uint32_t trx_in_block = 0;
+            uint16_t op_in_trx = 0;
+            uint64_t virtual_op = 0;
+            time_point_sec timestamp;
+            std::vector<char> serialized_op;
+            /// account and sequence of the operation in its history
+            std::vector<std::pair<account_name_type, uint32_t>> accounts;
+        };
+
+        /**
+         * Append-only store of the irreversible account history outside of the shared memory.
+         *
+         * The history is split into segments of segment_size entries (operation of an account).
+         * Each segment is a data file of the packed records in the order of the blocks and, when the
+         * segment is full, an index file written once and never changed:
+         *
+         * +--------+-----------------------------------------------------+------------------------+---------------------------+
+         * | Header | Accounts: name, first sequence, count, first offset | Offsets of the records | Blocks: number, offset    |
+         * +--------+-----------------------------------------------------+------------------------+---------------------------+
+         *
+         * Accounts are sorted by name, offsets of an account follow each other in the order of its
+         * sequences, so an operation is found by a binary search of the account and one lookup of the offset.
+         * Blocks are in ascending order with the offset of the first record of each block, records of a block
+         * follow each other, the last of them can be in the next segment.
+         * Files of full segments are read through memory mappings. The index of the last segment is kept
+         * in memory and rebuilt from its data file on open, the data file is the only one that needs to persist.
+         *
+         * Append and flush are called under the write lock of the database, reads under the read lock.
+         */
+        class account_history_store final {
+        public:
+            using visitor_type = std::function<void(uint32_t sequence, const account_history_record &)>;
+            using record_visitor_type = std::function<void(const account_history_record &)>;
+
+            explicit account_history_store(uint32_t segment_size = default_segment_size);
+
+            ~account_history_store();
+
+            void open(const fc::path &dir);
+
+            void close();
+
+            /**
+             * Remove all the segments, the history will be written from the beginning
+             */
+            void wipe();
+
+            /**
+             * Remove records of the blocks after block_num, e.g. when the state is behind the store
+             */
+            void truncate(uint32_t block_num);
+
+            void append(const account_history_record &record);
+
+            /**
+             * Flush the data file and let reads see the appended records
+             */
+            void flush();
+
+            /**
+             * Block of the last appended record
+             */
+            uint32_t head_block() const;
+
+            /**
+             * @return number of operations of the account in the store, it is the next sequence of the account
+             */
+            uint32_t get_account_size(const account_name_type &account) const;
+
+            /**
+             * Visit operations of the account with sequences from last down to first
+             */
+            void get_history(const account_name_type &account, uint32_t first, uint32_t last, visitor_type visitor) const;
+
+            /**
+             * Visit operations of the block in the order they were appended
+             */
+            void get_block_history(uint32_t block_num, record_visitor_type visitor) const;
+
+            static const uint32_t default_segment_size = 4 * 1024 * 1024;
+
+        private:
+            std::unique_ptr<detail::account_history_store_impl> my;
+        };
+
+    }
+} // golos::chain
+
+FC_REFLECT((golos::chain::account_history_record),
+    (trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(serialized_op)(accounts))
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <golos/protocol/block.hpp>
+
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+
+namespace golos {
+    namespace chain {
+
+        using golos::protocol::signed_block;
+        using golos::protocol::block_id_type;
+
+        namespace detail { class block_cache_impl; }
+
+        struct block_cache_stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint32_t size = 0;
+            uint32_t max_size = 0;
+        };
+
+        /**
+         * Bounded LRU cache of unpacked blocks, it keeps the irreversible blocks read from the block log.
+         * Blocks are shared, not copied: an evicted block stays alive while somebody holds it.
+         */
+        class block_cache final {
+        public:
+            explicit block_cache(uint32_t max_size = default_max_size);
+
+            ~block_cache();
+
+            void set_max_size(uint32_t max_size);
+
+            /**
+             * @param irreversible the block is in the block log, it can be found by number
+             */
+            void store(std::shared_ptr<const signed_block> block, bool irreversible = false);
+
+            std::shared_ptr<const signed_block> find(const block_id_type &id);
+
+            std::shared_ptr<const signed_block> find_irreversible(uint32_t block_num);
+
+            void clear();
+
+            block_cache_stats get_stats() const;
+
+            static const uint32_t default_max_size = 2048;
+
+        private:
+            std::unique_ptr<detail::block_cache_impl> my;
+        };
+
+    }
+} // golos::chain
+
+FC_REFLECT((golos::chain::block_cache_stats), (hits)(misses)(size)(max_size))
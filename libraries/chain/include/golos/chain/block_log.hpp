@@ -33,6 +33,10 @@ namespace golos {
          *
          * The main file is the only file that needs to persist. The index file can be reconstructed during a
          * linear scan of the main file.
+         *
+         * Both files are only written by append(). Reads go through read-only memory mappings of the files,
+         * so concurrent readers do not share a stream position and do not lock each other. Blocks are
+         * unpacked directly from the mapped memory.
          */
 
         class block_log {
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/signals.hpp>
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace golos {
+    namespace chain {
+
+        /**
+         * Number of calls and their time in microseconds
+         */
+        struct profile_counter {
+            uint64_t count = 0;
+            uint64_t total_time = 0;
+            uint64_t max_time = 0;
+
+            void add(uint64_t time) {
+                ++count;
+                total_time += time;
+                if (time > max_time) {
+                    max_time = time;
+                }
+            }
+        };
+
+        /**
+         * profile_counter with a histogram of the call times. Bucket N counts calls which took
+         * less than 2^N microseconds (and not less than 2^(N-1)), the last bucket counts the rest.
+         */
+        struct profile_histogram : public profile_counter {
+            static const uint32_t bucket_count = 20;
+
+            std::vector<uint64_t> buckets;
+
+            void add(uint64_t time);
+        };
+
+        /**
+         * Calls of one plugin handler of a database signal
+         */
+        struct signal_handler_profile : public profile_counter {
+            std::string plugin;
+            std::string signal;
+            /// calls which took longer than the slow handler threshold
+            uint64_t slow_count = 0;
+        };
+
+        /**
+         * One switch of the database to another fork, times are in microseconds
+         */
+        struct fork_switch_profile {
+            uint32_t new_head_num = 0;
+            /// blocks of the old branch which were undone
+            uint32_t undone_blocks = 0;
+            /// blocks of the new branch which were applied
+            uint32_t applied_blocks = 0;
+            /// a block of the new branch failed, the old branch was restored
+            bool failed = false;
+            /// checks of the new branch made before the write lock was taken
+            uint64_t prevalidate_time = 0;
+            /// time under the write lock
+            uint64_t total_time = 0;
+            std::vector<uint64_t> undo_times;
+            std::vector<uint64_t> apply_times;
+        };
+
+        struct block_profile {
+            /// time of the whole apply_block()
+            profile_counter blocks;
+            /// per-block passes of _apply_block()
+            std::map<std::string, profile_counter> stages;
+            /// time of the evaluators by operation type
+            std::map<std::string, profile_histogram> operations;
+            /// time of all handlers of the database signals
+            std::map<std::string, profile_counter> signals;
+            /// time of the fork switches under the write lock
+            profile_counter fork_switches;
+            uint32_t max_fork_switch_depth = 0;
+            std::vector<fork_switch_profile> recent_fork_switches;
+        };
+
+        /**
+         * Accumulates times of block application: the per-block passes of _apply_block(), the operation
+         * evaluators, the database signals and the plugin handlers connected by connect(). It costs nothing
+         * while it is disabled, when enabled it adds a couple of clock reads and an uncontended lock per
+         * measurement.
+         */
+        class block_profiler final {
+        public:
+            enum stage_type {
+                validate_block_header_stage,
+                apply_transactions_stage,
+                update_global_dynamic_data_stage,
+                update_signing_witness_stage,
+                update_last_irreversible_block_stage,
+                create_block_summary_stage,
+                clear_expired_transactions_stage,
+                clear_expired_orders_stage,
+                update_witness_schedule_stage,
+                update_median_feed_stage,
+                update_virtual_supply_stage,
+                clear_null_account_balance_stage,
+                process_funds_stage,
+                process_conversions_stage,
+                process_comment_cashout_stage,
+                process_vesting_withdrawals_stage,
+                process_savings_withdraws_stage,
+                pay_liquidity_reward_stage,
+                update_virtual_supply_after_rewards_stage,
+                account_recovery_processing_stage,
+                expire_escrow_ratification_stage,
+                process_decline_voting_rights_stage,
+                process_hardforks_stage,
+                notify_changed_objects_stage,
+                stage_count
+            };
+
+            enum signal_type {
+                pre_apply_operation_signal,
+                post_apply_operation_signal,
+                applied_block_signal,
+                on_pending_transaction_signal,
+                signal_count
+            };
+
+            block_profiler();
+
+            void enable(bool value) {
+                _enabled = value;
+            }
+
+            bool enabled() const {
+                return _enabled;
+            }
+
+            void add_block(const fc::microseconds &time);
+
+            void add_stage(stage_type stage, const fc::microseconds &time);
+
+            /// @param operation_type index of the operation in the operation static_variant
+            void add_operation(int operation_type, const fc::microseconds &time);
+
+            void add_signal(signal_type signal, const fc::microseconds &time);
+
+            /**
+             * Fork switches are rare, so they are recorded even while the profiler is disabled
+             */
+            void add_fork_switch(const fork_switch_profile &fork_switch);
+
+            /**
+             * Call the lambda and add its time to the stage
+             */
+            template<typename Lambda>
+            void measure(stage_type stage, Lambda &&callback) {
+                if (!_enabled) {
+                    callback();
+                    return;
+                }
+                auto start = fc::time_point::now();
+                callback();
+                add_stage(stage, fc::time_point::now() - start);
+            }
+
+            /**
+             * Call the lambda and add its time to the signal
+             */
+            template<typename Lambda>
+            void measure(signal_type signal, Lambda &&callback) {
+                if (!_enabled) {
+                    callback();
+                    return;
+                }
+                auto start = fc::time_point::now();
+                callback();
+                add_signal(signal, fc::time_point::now() - start);
+            }
+
+            /**
+             * Connect the handler of a plugin to the signal. Calls of the handler are counted and timed
+             * separately from other handlers of the signal, while the profiler is enabled.
+             */
+            template<typename Signal, typename Handler>
+            boost::signals2::connection connect(
+                Signal &signal, signal_type type, const std::string &plugin, Handler handler
+            ) {
+                auto handler_id = add_signal_handler(type, plugin);
+                return signal.connect([this, handler_id, handler](const auto &... args) {
+                    if (!_enabled) {
+                        handler(args...);
+                        return;
+                    }
+                    auto start = fc::time_point::now();
+                    handler(args...);
+                    add_signal_handler_call(handler_id, fc::time_point::now() - start);
+                });
+            }
+
+            /**
+             * Warn about handler calls which took longer than the threshold, 0 disables warnings
+             */
+            void set_slow_handler_threshold(const fc::microseconds &threshold);
+
+            block_profile get_profile() const;
+
+            std::vector<signal_handler_profile> get_signal_handlers() const;
+
+            void reset();
+
+            static const char *stage_name(stage_type stage);
+
+            static const char *signal_name(signal_type signal);
+
+            static const uint32_t recent_fork_switch_count = 16;
+
+        private:
+            size_t add_signal_handler(signal_type signal, const std::string &plugin);
+
+            void add_signal_handler_call(size_t handler_id, const fc::microseconds &time);
+
+            // both are set by API calls and read by the thread which applies blocks
+            std::atomic<bool> _enabled{false};
+            std::atomic<int64_t> _slow_handler_threshold{0};
+
+            mutable std::mutex _mutex;
+            profile_counter _blocks;
+            std::array<profile_counter, stage_count> _stages;
+            std::vector<profile_histogram> _operations;
+            std::array<profile_counter, signal_count> _signals;
+            profile_counter _fork_switches;
+            uint32_t _max_fork_switch_depth = 0;
+            std::deque<fork_switch_profile> _recent_fork_switches;
+            std::vector<signal_handler_profile> _handlers;
+        };
+
+    }
+} // golos::chain
+
+FC_REFLECT((golos::chain::profile_counter), (count)(total_time)(max_time))
+FC_REFLECT_DERIVED((golos::chain::profile_histogram), ((golos::chain::profile_counter)), (buckets))
+FC_REFLECT_DERIVED((golos::chain::signal_handler_profile), ((golos::chain::profile_counter)), (plugin)(signal)(slow_count))
+FC_REFLECT((golos::chain::fork_switch_profile),
+    (new_head_num)(undone_blocks)(applied_blocks)(failed)(prevalidate_time)(total_time)(undo_times)(apply_times))
+FC_REFLECT((golos::chain::block_profile),
+    (blocks)(stages)(operations)(signals)(fork_switches)(max_fork_switch_depth)(recent_fork_switches))
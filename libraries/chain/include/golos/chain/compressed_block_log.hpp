@@ -0,0 +1,79 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <golos/protocol/block.hpp>
+
+namespace golos {
+    namespace chain {
+
+        using namespace golos::protocol;
+
+        namespace detail { class compressed_block_log_impl; }
+
+        /* The compressed block log (block log v2) is an immutable archive of the blocks, intended for
+         * shipping replay seeds between nodes. Blocks are grouped into chunks of a fixed number of blocks,
+         * every chunk is compressed on its own, and a chunk index at the end of the file allows to find
+         * any chunk in O(1).
+         *
+         * +--------+---------+---------+-----+---------+-------------+--------+
+         * | Header | Chunk 1 | Chunk 2 | ... | Chunk N | Chunk Index | Footer |
+         * +--------+---------+---------+-----+---------+-------------+--------+
+         *
+         * Header:      magic, format version, blocks per chunk, compression method
+         * Chunk:       compressed payload. The uncompressed payload is a table of uint32 offsets of
+         *              the blocks inside the payload followed by the packed blocks themselves.
+         * Chunk Index: for every chunk its position in file, compressed size and uncompressed size
+         * Footer:      position of the chunk index, number of chunks, number of blocks, magic
+         *
+         * Block N is stored in chunk (N - 1) / blocks_per_chunk, so a random read costs one chunk
+         * decompression. The most recently decompressed chunk is cached, so reading blocks in order
+         * decompresses each chunk only once.
+         *
+         * The file is written once, by create(), a sequence of append() and close(). It can't be
+         * appended after it was closed. Use block_log to store the blocks of a running node.
+         */
+        class compressed_block_log {
+        public:
+            compressed_block_log();
+
+            ~compressed_block_log();
+
+            /**
+             * Open an existing file for reading
+             */
+            void open(const fc::path &file);
+
+            /**
+             * Create a new file for writing, an existing file is truncated
+             *
+             * @param blocks_per_chunk number of blocks compressed together
+             * @param compression_level zlib compression level, -1 for the zlib default
+             */
+            void create(const fc::path &file, uint32_t blocks_per_chunk = default_blocks_per_chunk, int compression_level = -1);
+
+            /**
+             * Finish writing of the file or release the opened file
+             */
+            void close();
+
+            bool is_open() const;
+
+            /**
+             * Append the next block. Blocks should be appended in order starting from block 1.
+             */
+            void append(const signed_block &b);
+
+            optional<signed_block> read_block_by_num(uint32_t block_num) const;
+
+            uint32_t head_block_num() const;
+
+            uint32_t blocks_per_chunk() const;
+
+            static const uint32_t default_blocks_per_chunk = 1000;
+
+        private:
+            std::unique_ptr<detail::compressed_block_log_impl> my;
+        };
+
+    }
+}
@@ -4,6 +4,10 @@
 #include <golos/chain/node_property_object.hpp>
 #include <golos/chain/fork_database.hpp>
 #include <golos/chain/block_log.hpp>
+#include <golos/chain/block_cache.hpp>
+#include <golos/chain/account_history_store.hpp>
+#include <golos/chain/block_profiler.hpp>
+#include <golos/chain/indexing_queue.hpp>
 #include <golos/chain/hardfork.hpp>
 #include <golos/protocol/protocol.hpp>
 
@@ -11,7 +15,9 @@
 
 #include <fc/log/logger.hpp>
 
+#include <atomic>
 #include <map>
+#include <set>
 
 namespace golos {
     namespace chain {
@@ -25,6 +31,8 @@ namespace golos {
 
         class database_impl;
 
+        class state_snapshot_index;
+
         class custom_operation_interpreter;
 
         struct operation_notification;
@@ -105,6 +113,21 @@ namespace golos {
              */
             void wipe(const fc::path &data_dir, const fc::path &shared_mem_dir, bool include_blocks);
 
+            /**
+             * Write all indexes to a state snapshot file. The state should be at an irreversible block,
+             * like it is right after open() or reindex().
+             */
+            void export_state(const fc::path &snapshot);
+
+            /**
+             * Fill a new shared memory from a state snapshot, then apply the blocks of the block log
+             * after the head block of the snapshot
+             */
+            void import_state(const fc::path &data_dir, const fc::path &shared_mem_dir, uint64_t shared_file_size,
+                              const fc::path &snapshot);
+
+            void register_snapshot_index(std::shared_ptr<state_snapshot_index> index);
+
             void close(bool rewind = true);
 
             //////////////////// db_block.cpp ////////////////////
@@ -281,6 +304,35 @@ namespace golos {
              */
             fc::signal<void(const signed_transaction &)> on_applied_transaction;
 
+            /**
+             * Connect a plugin handler to the signal. Unlike the direct connection, calls of
+             * the handler are counted and timed per plugin by the profiler.
+             *
+             * Handlers of the plugins enabled by set_async_indexing() and allow_async_indexing() are connected
+             * to the indexing queue instead, they are called for operations of applied blocks only, after
+             * the block is applied.
+             */
+            template<typename Handler>
+            boost::signals2::connection connect_pre_apply_operation(const std::string &plugin, Handler &&handler) {
+                return _profiler.connect(
+                    is_async_indexing(plugin) ? _indexing_queue.pre_apply_operation : pre_apply_operation,
+                    block_profiler::pre_apply_operation_signal, plugin, std::forward<Handler>(handler));
+            }
+
+            template<typename Handler>
+            boost::signals2::connection connect_post_apply_operation(const std::string &plugin, Handler &&handler) {
+                return _profiler.connect(
+                    is_async_indexing(plugin) ? _indexing_queue.post_apply_operation : post_apply_operation,
+                    block_profiler::post_apply_operation_signal, plugin, std::forward<Handler>(handler));
+            }
+
+            template<typename Handler>
+            boost::signals2::connection connect_applied_block(const std::string &plugin, Handler &&handler) {
+                return _profiler.connect(
+                    is_async_indexing(plugin) ? _indexing_queue.applied_block : applied_block,
+                    block_profiler::applied_block_signal, plugin, std::forward<Handler>(handler));
+            }
+
             /**
              *  Emitted After a block has been applied and committed.  The callback
              *  should not yield and should execute quickly.
@@ -464,6 +516,10 @@ namespace golos {
              * can be reapplied at the proper time */
             std::deque<signed_transaction> _popped_tx;
 
+            /** in the incremental pending mode, the pending transactions which were not re-applied
+             * after the last block */
+            std::deque<signed_transaction> _postponed_tx;
+
 
             bool apply_order(const limit_order_object &new_order_object);
 
@@ -501,6 +557,105 @@ namespace golos {
 
             void set_flush_interval(uint32_t flush_blocks);
 
+            /**
+             * Set the number of blocks that reindex() may read ahead of the block being applied
+             */
+            void set_replay_queue_size(uint32_t blocks);
+
+            /**
+             * Set the number of threads that recover signature keys of block transactions
+             * before the write lock is taken, 0 recovers them on the calling thread
+             */
+            void set_signature_recovery_threads(uint32_t threads);
+
+            /**
+             * In the incremental pending mode push_block doesn't re-apply pending transactions.
+             * Transactions included into the block and expired ones are dropped, the rest are
+             * postponed until apply_postponed_transactions() is called.
+             */
+            void set_incremental_pending(bool value);
+
+            bool is_incremental_pending() const;
+
+            /**
+             * Re-apply postponed transactions to the pending state until max_time elapses
+             *
+             * @return number of transactions that are still postponed
+             */
+            size_t apply_postponed_transactions(fc::microseconds max_time);
+
+            /**
+             * Number of blocks kept in the block cache, which serves reads of the irreversible blocks
+             * from the block log
+             */
+            void set_block_cache_size(uint32_t blocks);
+
+            block_cache_stats get_block_cache_stats() const;
+
+            /**
+             * Store of the irreversible account history outside of the shared memory, the account_history
+             * plugin sets it when the history is configured to be kept in files and moves the history to it
+             */
+            void set_account_history_store(std::shared_ptr<account_history_store> store);
+
+            const std::shared_ptr<account_history_store> &get_account_history_store() const;
+
+            /**
+             * Plugins which handlers of pre_apply_operation, post_apply_operation and applied_block
+             * are called from the indexing queue instead of the block application. Must be set before
+             * the plugins connect their handlers.
+             *
+             * @param max_queue_size number of queued blocks after which they are indexed on the block application thread
+             * @param batch_size max number of blocks dispatched by the indexing thread under one write lock
+             */
+            void set_async_indexing(const std::set<std::string> &plugins, uint32_t max_queue_size, uint32_t batch_size);
+
+            /**
+             * Called by a plugin before it connects its handlers, when they can be called after the block
+             * and later blocks are applied. Such handlers may read only the notified operations, objects
+             * of the plugin and notification_time(), the rest of the state is ahead of the notified block.
+             */
+            void allow_async_indexing(const std::string &plugin);
+
+            bool is_async_indexing(const std::string &plugin) const;
+
+            /**
+             * Head block time at the moment the notified operation was applied, handlers called from
+             * the indexing queue should use it instead of head_block_time()
+             */
+            time_point_sec notification_time() const;
+
+            /**
+             * Start the thread dispatching the indexing queue. Until it is started, queued blocks are
+             * dispatched right after they are applied. Throws if a plugin passed to set_async_indexing()
+             * hasn't called allow_async_indexing().
+             */
+            void start_async_indexing();
+
+            /**
+             * Stop the indexing thread and dispatch what is left in the queue
+             */
+            void stop_async_indexing();
+
+            /**
+             * Dispatch up to max_blocks queued blocks under the write lock. Handlers write into the undo
+             * session of the head block, so pending transactions are taken off the state meanwhile.
+             *
+             * @return number of dispatched blocks
+             */
+            size_t dispatch_indexing_queue(size_t max_blocks);
+
+            /**
+             * Times of block application stages, evaluators and signals, disabled by default
+             */
+            block_profiler &profiler() {
+                return _profiler;
+            }
+
+            const block_profiler &profiler() const {
+                return _profiler;
+            }
+
 #ifdef STEEMIT_BUILD_TESTNET
             bool liquidity_rewards_enabled = true;
             bool skip_price_feed_limit_check = true;
@@ -569,6 +724,27 @@ namespace golos {
             protocol::hardfork_version _hardfork_versions[STEEMIT_NUM_HARDFORKS + 1];
 
             block_log _block_log;
+            std::shared_ptr<block_cache> _block_cache;
+            std::shared_ptr<account_history_store> _account_history_store;
+
+            optional<signed_block> read_block_from_log(uint32_t block_num) const;
+
+            struct fork_checks {
+                item_ptr item;
+                bool merkle_checked = false;
+                fc::optional<public_key_type> signee;
+            };
+
+            /**
+             * If the block makes the database switch to another fork, make the checks of the fork blocks
+             * which don't depend on the state: recover signature keys of their transactions into the cache,
+             * check merkle roots and recover signees. It is called before the write lock is taken, so
+             * the switch under the lock only applies the state changes.
+             */
+            std::vector<fork_checks> prevalidate_fork(const signed_block &new_block, uint32_t skip);
+
+            /// time of prevalidate_fork() for the block being pushed
+            fc::microseconds _fork_prevalidate_time;
 
             // this function needs access to _plugin_index_signal
             template<typename MultiIndexType>
@@ -591,6 +767,21 @@ namespace golos {
 
             uint32_t _last_free_gb_printed = 0;
 
+            uint32_t _replay_queue_size = 1024;
+
+            bool _incremental_pending = false;
+
+            block_profiler _profiler;
+
+            std::vector<std::shared_ptr<state_snapshot_index>> _snapshot_indexes;
+
+            indexing_queue _indexing_queue;
+            std::set<std::string> _async_indexing_plugins;
+            std::set<std::string> _async_indexing_allowed;
+            uint32_t _async_indexing_queue_size = 1000;
+            uint32_t _async_indexing_batch_size = 100;
+            std::atomic<bool> _async_indexing_started{false};
+
             flat_map<std::string, std::shared_ptr<custom_operation_interpreter>> _custom_operation_interpreters;
             std::string _json_schema;
         };
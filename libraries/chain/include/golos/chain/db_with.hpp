@@ -83,6 +83,60 @@ namespace golos {
                 std::vector<signed_transaction> _pending_transactions;
             };
 
+/**
+ * Class used to help the with_postponed_pending_transactions
+ * implementation.
+ *
+ * Unlike pending_transactions_restorer it doesn't re-apply anything. Transactions
+ * included into the new block and expired transactions are dropped, the rest are
+ * moved to the postponed queue, which is re-validated later by
+ * database::apply_postponed_transactions().
+ */
+            struct pending_transactions_postponer {
+                pending_transactions_postponer(database &db, std::vector<signed_transaction> &&pending_transactions)
+                        : _db(db),
+                          _pending_transactions(std::move(pending_transactions)),
+                          _postponed_transactions(std::move(db._postponed_tx)) {
+                    _db.clear_pending();
+                }
+
+                ~pending_transactions_postponer() {
+                    std::set<transaction_id_type> ids;
+                    std::deque<signed_transaction> postponed;
+                    auto now = _db.head_block_time();
+
+                    auto postpone = [&](signed_transaction &tx) {
+                        try {
+                            if (tx.expiration <= now) {
+                                return;
+                            }
+                            auto id = tx.id();
+                            if (ids.insert(id).second && !_db.is_known_transaction(id)) {
+                                postponed.push_back(std::move(tx));
+                            }
+                        } catch (const fc::exception &) {
+                        }
+                    };
+
+                    // popped transactions first, they were received before anything else
+                    for (auto &tx : _db._popped_tx) {
+                        postpone(tx);
+                    }
+                    _db._popped_tx.clear();
+                    for (auto &tx : _postponed_transactions) {
+                        postpone(tx);
+                    }
+                    for (auto &tx : _pending_transactions) {
+                        postpone(tx);
+                    }
+                    _db._postponed_tx = std::move(postponed);
+                }
+
+                database &_db;
+                std::vector<signed_transaction> _pending_transactions;
+                std::deque<signed_transaction> _postponed_transactions;
+            };
+
 /**
  * Set the skip_flags to the given value, call callback,
  * then reset skip_flags to their previous value after
@@ -116,6 +170,23 @@ namespace golos {
                 return;
             }
 
+/**
+ * Empty pending_transactions, call callback,
+ * then move pending_transactions to the postponed queue after callback is done.
+ *
+ * Included and expired pending transactions will be dropped,
+ * the rest are not re-applied until database::apply_postponed_transactions() is called.
+ */
+            template<typename Lambda>
+            void with_postponed_pending_transactions(
+                    database &db,
+                    std::vector<signed_transaction> &&pending_transactions,
+                    Lambda callback) {
+                pending_transactions_postponer postponer(db, std::move(pending_transactions));
+                callback();
+                return;
+            }
+
         }
     }
 } // golos::chain::detail
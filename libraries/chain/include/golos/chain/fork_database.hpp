@@ -16,14 +16,22 @@ namespace golos {
 
         using golos::protocol::signed_block;
         using golos::protocol::block_id_type;
+        using golos::protocol::public_key_type;
 
         struct fork_item {
-            fork_item(signed_block d)
-                    : num(d.block_num()), id(d.id()), data(std::move(d)) {
+            fork_item(std::shared_ptr<const signed_block> d)
+                    : num(d->block_num()), id(d->id()), block(std::move(d)) {
             }
 
             block_id_type previous_id() const {
-                return data.previous;
+                return block->previous;
+            }
+
+            /**
+             * The full block, it is shared with the readers instead of being copied
+             */
+            const std::shared_ptr<const signed_block> &data() const {
+                return block;
             }
 
             weak_ptr<fork_item> prev;
@@ -34,7 +42,13 @@ namespace golos {
              */
             bool invalid = false;
             block_id_type id;
-            signed_block data;
+            std::shared_ptr<const signed_block> block;
+
+            /**
+             * Results of the checks made before switching to the fork of the block, they don't depend on the state
+             */
+            bool merkle_checked = false;
+            fc::optional<public_key_type> signee;
         };
 
         typedef shared_ptr<fork_item> item_ptr;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <golos/chain/database.hpp>
+#include <golos/chain/state_snapshot.hpp>
 
 namespace golos {
     namespace chain {
@@ -8,6 +9,7 @@ namespace golos {
         template<typename MultiIndexType>
         void _add_index_impl(database &db) {
             db.add_index<MultiIndexType>();
+            add_snapshot_index<MultiIndexType>(db);
         }
 
         template<typename MultiIndexType>
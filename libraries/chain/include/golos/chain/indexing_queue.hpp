@@ -0,0 +1,137 @@
+#pragma once
+
+#include <golos/protocol/block.hpp>
+#include <golos/chain/operation_notification.hpp>
+
+#include <fc/optional.hpp>
+#include <fc/signals.hpp>
+#include <fc/time.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace golos {
+    namespace chain {
+
+        using golos::protocol::signed_block;
+
+        /**
+         * Copy of an operation_notification which outlives the applied operation
+         */
+        struct queued_operation {
+            bool post_apply = false;
+            operation op;
+            transaction_id_type trx_id;
+            uint32_t block = 0;
+            uint32_t trx_in_block = 0;
+            uint16_t op_in_trx = 0;
+            uint64_t virtual_op = 0;
+            /// head block time when the operation was applied
+            fc::time_point_sec head_block_time;
+        };
+
+        /**
+         * Applied block with its operations in the order they were notified
+         */
+        struct queued_block {
+            signed_block block;
+            uint32_t block_num = 0;
+            std::vector<queued_operation> operations;
+            /// head block when the block was dispatched, its handlers wrote into the undo session of that block
+            uint32_t dispatched_at = 0;
+        };
+
+        /**
+         * Ordered queue of the applied blocks and their operations for the plugins which index them
+         * asynchronously. The database fills it while applying blocks, and handlers connected to its
+         * signals are called by dispatch() later, usually on the indexing thread of the database.
+         *
+         * Handlers write their objects into the undo session of the head block at the moment of dispatch.
+         * When that block is popped, chainbase reverts them, so pop_block() returns the undone blocks
+         * to the front of the queue (and drops the popped block) to have them dispatched again.
+         */
+        class indexing_queue final {
+        public:
+            fc::signal<void(const operation_notification &)> pre_apply_operation;
+            fc::signal<void(const operation_notification &)> post_apply_operation;
+            fc::signal<void(const signed_block &)> applied_block;
+
+            bool has_operation_handlers() const {
+                return !pre_apply_operation.empty() || !post_apply_operation.empty();
+            }
+
+            bool has_handlers() const {
+                return has_operation_handlers() || !applied_block.empty();
+            }
+
+            /**
+             * Drop operations added after the last add_block(), they don't belong to any applied block
+             */
+            void discard_operations();
+
+            void add_operation(bool post_apply, const operation_notification &note, fc::time_point_sec head_block_time);
+
+            /**
+             * Move the block with the operations added since the last add_block() to the queue
+             */
+            void add_block(const signed_block &block);
+
+            /**
+             * Called after the block is undone
+             */
+            void pop_block(uint32_t block_num);
+
+            /**
+             * Call handlers for up to max_blocks queued blocks
+             *
+             * @param head_block_num the block which undo session receives writes of the handlers
+             * @param last_irreversible_block_num dispatched blocks up to it are forgotten
+             * @return number of dispatched blocks
+             */
+            size_t dispatch(uint32_t head_block_num, uint32_t last_irreversible_block_num, size_t max_blocks);
+
+            /**
+             * Head block time at the moment the notified operation or block was applied, it is set only
+             * while handlers are called by dispatch(). Accessed under the write lock of the database.
+             */
+            const fc::optional<fc::time_point_sec> &notification_time() const {
+                return _notification_time;
+            }
+
+            /**
+             * Number of blocks waiting for dispatch
+             */
+            size_t size() const;
+
+            /**
+             * Wait until there is something to dispatch
+             *
+             * @return false if stop() was called
+             */
+            bool wait();
+
+            void stop();
+
+            /**
+             * Let wait() block again after stop()
+             */
+            void reset();
+
+        private:
+            void notify(const queued_block &block);
+
+            mutable std::mutex _mutex;
+            std::condition_variable _cv;
+            bool _stopped = false;
+
+            std::vector<queued_operation> _operations;
+            std::deque<queued_block> _queue;
+            std::deque<queued_block> _dispatched;
+
+            fc::optional<fc::time_point_sec> _notification_time;
+        };
+
+    }
+} // golos::chain
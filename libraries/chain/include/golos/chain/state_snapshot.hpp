@@ -0,0 +1,321 @@
+#pragma once
+
+#include <golos/chain/database.hpp>
+#include <golos/chain/shared_authority.hpp>
+#include <golos/chain/steem_object_types.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+#include <string>
+
+namespace golos {
+    namespace chain {
+
+        namespace detail {
+            class state_snapshot_writer_impl;
+            class state_snapshot_reader_impl;
+        }
+
+        /* The state snapshot is a dump of all chainbase indexes, core and plugin ones, which allows to start
+         * a node without replaying the block log.
+         *
+         * +-------+---------+--------------------+----------+
+         * | Magic | Version | Compressed payload | Checksum |
+         * +-------+---------+--------------------+----------+
+         *
+         * Payload:  state_snapshot_header, then for every index the name of its object type, the number
+         *           of objects, the id of the next object to create and the objects in the order of their ids.
+         *           An object is its id followed by its reflected fields packed with fc::raw.
+         * Checksum: sha256 of the uncompressed payload
+         *
+         * Unlike snapshot_state, which is a json with the accounts imported at a hardfork, the state
+         * snapshot restores the whole database exactly as it was at the head block of the snapshot.
+         */
+        struct state_snapshot_header {
+            chain_id_type chain_id;
+            uint32_t head_block_num = 0;
+            block_id_type head_block_id;
+            fc::time_point_sec head_block_time;
+            uint32_t index_count = 0;
+        };
+
+        const uint32_t state_snapshot_version = 2;
+
+        /**
+         * Compressing output stream of a snapshot file, compatible with fc::raw::pack()
+         */
+        class state_snapshot_writer final {
+        public:
+            /**
+             * @param compression_level zlib compression level, -1 for the zlib default
+             */
+            explicit state_snapshot_writer(const fc::path &file, int compression_level = -1);
+
+            ~state_snapshot_writer();
+
+            void write(const char *data, size_t size);
+
+            void put(char c) {
+                write(&c, 1);
+            }
+
+            /**
+             * Flush the payload and write the checksum
+             */
+            void finish();
+
+            /// size of the uncompressed payload written so far
+            uint64_t raw_size() const;
+
+            /// size of the file, known after finish()
+            uint64_t file_size() const;
+
+        private:
+            std::unique_ptr<detail::state_snapshot_writer_impl> my;
+        };
+
+        /**
+         * Decompressing input stream of a snapshot file, compatible with fc::raw::unpack()
+         */
+        class state_snapshot_reader final {
+        public:
+            explicit state_snapshot_reader(const fc::path &file);
+
+            ~state_snapshot_reader();
+
+            void read(char *data, size_t size);
+
+            void get(char &c) {
+                read(&c, 1);
+            }
+
+            /**
+             * Check that the whole payload has been read and it matches the checksum
+             */
+            void finish();
+
+            /// size of the uncompressed payload read so far
+            uint64_t raw_size() const;
+
+        private:
+            std::unique_ptr<detail::state_snapshot_reader_impl> my;
+        };
+
+        namespace detail {
+            /*
+             * Objects are serialized field by field through their reflection, fields in shared memory
+             * (strings, vectors and maps with the chainbase allocator) are serialized as their std counterparts.
+             */
+
+            template<typename Stream, typename T>
+            void pack_object(Stream &s, const T &obj);
+
+            template<typename Stream, typename T>
+            void unpack_object(Stream &s, T &obj);
+
+            template<typename Stream, typename T>
+            void pack_value(Stream &s, const T &v) {
+                fc::raw::pack(s, v);
+            }
+
+            template<typename Stream>
+            void pack_value(Stream &s, const shared_string &v) {
+                fc::raw::pack(s, fc::unsigned_int(v.size()));
+                if (v.size()) {
+                    s.write(v.data(), v.size());
+                }
+            }
+
+            template<typename Stream, typename T>
+            void pack_value(Stream &s, const bip::vector<T, allocator<T>> &v) {
+                fc::raw::pack(s, fc::unsigned_int(v.size()));
+                for (const auto &item : v) {
+                    pack_value(s, item);
+                }
+            }
+
+            template<typename Stream, typename K, typename V, typename C, typename A>
+            void pack_value(Stream &s, const bip::flat_map<K, V, C, A> &v) {
+                fc::raw::pack(s, fc::unsigned_int(v.size()));
+                for (const auto &item : v) {
+                    pack_value(s, item.first);
+                    pack_value(s, item.second);
+                }
+            }
+
+            template<typename Stream>
+            void pack_value(Stream &s, const shared_authority &v) {
+                pack_object(s, v);
+            }
+
+            template<typename Stream, typename T>
+            void unpack_value(Stream &s, T &v) {
+                fc::raw::unpack(s, v);
+            }
+
+            template<typename Stream>
+            void unpack_value(Stream &s, shared_string &v) {
+                fc::unsigned_int size;
+                fc::raw::unpack(s, size);
+                std::string str(size.value, '\0');
+                if (size.value) {
+                    s.read(&str[0], size.value);
+                }
+                v.assign(str.begin(), str.end());
+            }
+
+            template<typename Stream, typename T>
+            void unpack_value(Stream &s, bip::vector<T, allocator<T>> &v) {
+                fc::unsigned_int size;
+                fc::raw::unpack(s, size);
+                v.clear();
+                v.reserve(size.value);
+                for (uint32_t i = 0; i < size.value; ++i) {
+                    T item;
+                    unpack_value(s, item);
+                    v.push_back(std::move(item));
+                }
+            }
+
+            template<typename Stream, typename K, typename V, typename C, typename A>
+            void unpack_value(Stream &s, bip::flat_map<K, V, C, A> &v) {
+                fc::unsigned_int size;
+                fc::raw::unpack(s, size);
+                v.clear();
+                v.reserve(size.value);
+                for (uint32_t i = 0; i < size.value; ++i) {
+                    K key;
+                    V value;
+                    unpack_value(s, key);
+                    unpack_value(s, value);
+                    v.emplace(std::move(key), std::move(value));
+                }
+            }
+
+            template<typename Stream>
+            void unpack_value(Stream &s, shared_authority &v) {
+                unpack_object(s, v);
+            }
+
+            template<typename Stream, typename Class>
+            struct pack_member_visitor {
+                pack_member_visitor(Stream &s, const Class &obj)
+                        : _s(s), _obj(obj) {
+                }
+
+                template<typename Member, class Base, Member (Base::*member)>
+                void operator()(const char *) const {
+                    pack_value(_s, _obj.*member);
+                }
+
+                Stream &_s;
+                const Class &_obj;
+            };
+
+            template<typename Stream, typename Class>
+            struct unpack_member_visitor {
+                unpack_member_visitor(Stream &s, Class &obj)
+                        : _s(s), _obj(obj) {
+                }
+
+                template<typename Member, class Base, Member (Base::*member)>
+                void operator()(const char *) const {
+                    unpack_value(_s, _obj.*member);
+                }
+
+                Stream &_s;
+                Class &_obj;
+            };
+
+            template<typename Stream, typename T>
+            void pack_object(Stream &s, const T &obj) {
+                fc::reflector<T>::visit(pack_member_visitor<Stream, T>(s, obj));
+            }
+
+            template<typename Stream, typename T>
+            void unpack_object(Stream &s, T &obj) {
+                fc::reflector<T>::visit(unpack_member_visitor<Stream, T>(s, obj));
+            }
+        }
+
+        /**
+         * Writes and reads objects of one chainbase index
+         */
+        class state_snapshot_index {
+        public:
+            virtual ~state_snapshot_index() = default;
+
+            /// name of the object type, it identifies the index in the snapshot
+            virtual std::string name() const = 0;
+
+            virtual uint64_t size(const database &db) const = 0;
+
+            virtual void write(const database &db, state_snapshot_writer &out) const = 0;
+
+            /**
+             * Create count objects in the empty index
+             */
+            virtual void read(database &db, state_snapshot_reader &in, uint64_t count) const = 0;
+        };
+
+        template<typename MultiIndexType>
+        class state_snapshot_index_impl final : public state_snapshot_index {
+        public:
+            using object_type = typename MultiIndexType::value_type;
+
+            std::string name() const override {
+                return fc::get_typename<object_type>::name();
+            }
+
+            uint64_t size(const database &db) const override {
+                return db.get_index<MultiIndexType>().indices().size();
+            }
+
+            void write(const database &db, state_snapshot_writer &out) const override {
+                const auto &index = db.get_index<MultiIndexType>();
+                fc::raw::pack(out, index.get_next_id());
+                for (const auto &obj : index.indices()) {
+                    fc::raw::pack(out, obj.id._id);
+                    detail::pack_object(out, obj);
+                }
+            }
+
+            void read(database &db, state_snapshot_reader &in, uint64_t count) const override {
+                FC_ASSERT(db.get_index<MultiIndexType>().indices().empty(), "Index of ${n} isn't empty", ("n", name()));
+
+                int64_t next_id = 0;
+                fc::raw::unpack(in, next_id);
+                FC_ASSERT(next_id >= 0 && uint64_t(next_id) >= count, "Wrong next id of ${n}",
+                          ("n", name())("next_id", next_id)("count", count));
+
+                int64_t last_id = -1;
+                for (uint64_t i = 0; i < count; ++i) {
+                    int64_t id;
+                    fc::raw::unpack(in, id);
+                    FC_ASSERT(id > last_id && id < next_id, "Objects of ${n} are not ordered by id",
+                              ("n", name())("id", id)("next_id", next_id));
+
+                    db.create<object_type>([&](object_type &o) {
+                        detail::unpack_object(in, o);
+                        o.id = typename object_type::id_type(id);
+                    });
+                    last_id = id;
+                }
+
+                // the index moves the next id by one per created object, ids of the removed objects aren't reused
+                db.get_mutable_index<MultiIndexType>().set_next_id(next_id);
+            }
+        };
+
+        template<typename MultiIndexType>
+        void add_snapshot_index(database &db) {
+            db.register_snapshot_index(std::make_shared<state_snapshot_index_impl<MultiIndexType>>());
+        }
+
+    }
+} // golos::chain
+
+FC_REFLECT((golos::chain::state_snapshot_header), (chain_id)(head_block_num)(head_block_id)(head_block_time)(index_count))
@@ -0,0 +1,158 @@
+#include <golos/chain/indexing_queue.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace golos {
+    namespace chain {
+
+        void indexing_queue::discard_operations() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _operations.clear();
+        }
+
+        void indexing_queue::add_operation(
+            bool post_apply, const operation_notification &note, fc::time_point_sec head_block_time
+        ) {
+            queued_operation op;
+            op.post_apply = post_apply;
+            op.op = note.op;
+            op.trx_id = note.trx_id;
+            op.block = note.block;
+            op.trx_in_block = note.trx_in_block;
+            op.op_in_trx = note.op_in_trx;
+            op.virtual_op = note.virtual_op;
+            op.head_block_time = head_block_time;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _operations.push_back(std::move(op));
+        }
+
+        void indexing_queue::add_block(const signed_block &block) {
+            queued_block item;
+            item.block = block;
+            item.block_num = block.block_num();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                item.operations = std::move(_operations);
+                _operations.clear();
+                _queue.push_back(std::move(item));
+            }
+            _cv.notify_one();
+        }
+
+        void indexing_queue::pop_block(uint32_t block_num) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _operations.clear();
+
+                // the popped block isn't a part of the chain anymore
+                while (!_queue.empty() && _queue.back().block_num >= block_num) {
+                    _queue.pop_back();
+                }
+
+                // chainbase has reverted what handlers wrote while the popped block was the head
+                while (!_dispatched.empty() && _dispatched.back().dispatched_at >= block_num) {
+                    auto item = std::move(_dispatched.back());
+                    _dispatched.pop_back();
+                    if (item.block_num < block_num) {
+                        item.dispatched_at = 0;
+                        _queue.push_front(std::move(item));
+                    }
+                }
+            }
+            _cv.notify_one();
+        }
+
+        size_t indexing_queue::dispatch(
+            uint32_t head_block_num, uint32_t last_irreversible_block_num, size_t max_blocks
+        ) {
+            size_t result = 0;
+            for (; result < max_blocks; ++result) {
+                queued_block item;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_queue.empty()) {
+                        break;
+                    }
+                    item = std::move(_queue.front());
+                    _queue.pop_front();
+                }
+
+                notify(item);
+
+                item.dispatched_at = head_block_num;
+                std::lock_guard<std::mutex> lock(_mutex);
+                _dispatched.push_back(std::move(item));
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            while (!_dispatched.empty() && _dispatched.front().dispatched_at <= last_irreversible_block_num) {
+                _dispatched.pop_front();
+            }
+            return result;
+        }
+
+        void indexing_queue::notify(const queued_block &item) {
+            // unlike the synchronous signals, failures of handlers can't reject the block anymore,
+            // each notification is isolated, so a failed one doesn't hide the rest of the block
+            for (const auto &op : item.operations) {
+                operation_notification note(op.op);
+                note.trx_id = op.trx_id;
+                note.block = op.block;
+                note.trx_in_block = op.trx_in_block;
+                note.op_in_trx = op.op_in_trx;
+                note.virtual_op = op.virtual_op;
+                _notification_time = op.head_block_time;
+                try {
+                    if (op.post_apply) {
+                        post_apply_operation(note);
+                    } else {
+                        pre_apply_operation(note);
+                    }
+                } catch (const fc::exception &e) {
+                    elog("Caught exception in plugin while indexing operation ${o} of transaction ${t} in block ${n}: ${e}",
+                         ("o", op.op)("t", op.trx_in_block)("n", item.block_num)("e", e.to_detail_string()));
+                } catch (...) {
+                    elog("Caught unexpected exception in plugin while indexing operation ${o} of transaction ${t} in block ${n}",
+                         ("o", op.op)("t", op.trx_in_block)("n", item.block_num));
+                }
+            }
+
+            _notification_time = item.block.timestamp;
+            try {
+                applied_block(item.block);
+            } catch (const fc::exception &e) {
+                elog("Caught exception in plugin while indexing block ${n}: ${e}",
+                     ("n", item.block_num)("e", e.to_detail_string()));
+            } catch (...) {
+                elog("Caught unexpected exception in plugin while indexing block ${n}", ("n", item.block_num));
+            }
+            _notification_time.reset();
+        }
+
+        size_t indexing_queue::size() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _queue.size();
+        }
+
+        bool indexing_queue::wait() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&]() { return _stopped || !_queue.empty(); });
+            return !_stopped;
+        }
+
+        void indexing_queue::stop() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopped = true;
+            }
+            _cv.notify_all();
+        }
+
+        void indexing_queue::reset() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped = false;
+        }
+
+    }
+} // golos::chain
@@ -0,0 +1,190 @@
+#include <golos/chain/state_snapshot.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace golos {
+    namespace chain {
+
+        namespace detail {
+
+            const char state_snapshot_magic[8] = {'G', 'L', 'S', 'S', 'N', 'A', 'P', '1'};
+
+            const size_t state_snapshot_buffer_size = 1 << 20;
+
+            class state_snapshot_writer_impl {
+            public:
+                std::ofstream file;
+                z_stream stream;
+                std::vector<char> buffer;
+                fc::sha256::encoder checksum;
+                uint64_t raw_size = 0;
+                uint64_t file_size = 0;
+                bool finished = false;
+
+                void deflate_buffer(int flush) {
+                    int res;
+                    do {
+                        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+                        stream.avail_out = buffer.size();
+                        res = deflate(&stream, flush);
+                        FC_ASSERT(res != Z_STREAM_ERROR, "Failed to compress state snapshot");
+                        file.write(buffer.data(), buffer.size() - stream.avail_out);
+                    } while (stream.avail_out == 0);
+                    FC_ASSERT(file.good(), "Failed to write state snapshot");
+                }
+            };
+
+            class state_snapshot_reader_impl {
+            public:
+                std::ifstream file;
+                z_stream stream;
+                std::vector<char> buffer;
+                fc::sha256::encoder checksum;
+                uint64_t raw_size = 0;
+                uint64_t payload_end = 0;
+                uint64_t payload_pos = 0;
+                bool stream_end = false;
+
+                void inflate_buffer() {
+                    FC_ASSERT(!stream_end, "Unexpected end of state snapshot");
+                    if (!stream.avail_in) {
+                        auto chunk = std::min<uint64_t>(buffer.size(), payload_end - payload_pos);
+                        FC_ASSERT(chunk, "State snapshot is truncated");
+                        file.read(buffer.data(), chunk);
+                        FC_ASSERT(file.good(), "Failed to read state snapshot");
+                        payload_pos += chunk;
+                        stream.next_in = reinterpret_cast<Bytef *>(buffer.data());
+                        stream.avail_in = chunk;
+                    }
+
+                    auto res = inflate(&stream, Z_NO_FLUSH);
+                    FC_ASSERT(res == Z_OK || res == Z_STREAM_END, "Failed to decompress state snapshot", ("error", res));
+                    stream_end = (res == Z_STREAM_END);
+                }
+            };
+
+            const size_t state_snapshot_checksum_size = fc::sha256().data_size();
+
+        }
+
+        state_snapshot_writer::state_snapshot_writer(const fc::path &file, int compression_level)
+                : my(new detail::state_snapshot_writer_impl()) {
+            my->file.open(file.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc);
+            FC_ASSERT(my->file.good(), "Can't create state snapshot ${f}", ("f", file));
+
+            my->file.write(detail::state_snapshot_magic, sizeof(detail::state_snapshot_magic));
+            my->file.write(reinterpret_cast<const char *>(&state_snapshot_version), sizeof(state_snapshot_version));
+
+            std::memset(&my->stream, 0, sizeof(my->stream));
+            auto res = deflateInit(&my->stream, compression_level);
+            FC_ASSERT(res == Z_OK, "Failed to initialize compression of state snapshot", ("error", res));
+            my->buffer.resize(detail::state_snapshot_buffer_size);
+        }
+
+        state_snapshot_writer::~state_snapshot_writer() {
+            deflateEnd(&my->stream);
+        }
+
+        void state_snapshot_writer::write(const char *data, size_t size) {
+            FC_ASSERT(!my->finished, "State snapshot is already finished");
+            my->checksum.write(data, size);
+            my->raw_size += size;
+
+            my->stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            my->stream.avail_in = size;
+            my->deflate_buffer(Z_NO_FLUSH);
+        }
+
+        void state_snapshot_writer::finish() {
+            FC_ASSERT(!my->finished, "State snapshot is already finished");
+            my->stream.next_in = nullptr;
+            my->stream.avail_in = 0;
+            my->deflate_buffer(Z_FINISH);
+
+            auto checksum = my->checksum.result();
+            my->file.write(checksum.data(), checksum.data_size());
+            my->file_size = my->file.tellp();
+            my->file.close();
+            FC_ASSERT(!my->file.fail(), "Failed to write state snapshot");
+            my->finished = true;
+        }
+
+        uint64_t state_snapshot_writer::raw_size() const {
+            return my->raw_size;
+        }
+
+        uint64_t state_snapshot_writer::file_size() const {
+            return my->file_size;
+        }
+
+        state_snapshot_reader::state_snapshot_reader(const fc::path &file)
+                : my(new detail::state_snapshot_reader_impl()) {
+            my->file.open(file.generic_string(), std::ios::in | std::ios::binary);
+            FC_ASSERT(my->file.good(), "Can't open state snapshot ${f}", ("f", file));
+
+            char magic[sizeof(detail::state_snapshot_magic)];
+            uint32_t version = 0;
+            my->file.read(magic, sizeof(magic));
+            my->file.read(reinterpret_cast<char *>(&version), sizeof(version));
+            FC_ASSERT(my->file.good() && std::memcmp(magic, detail::state_snapshot_magic, sizeof(magic)) == 0,
+                      "${f} is not a state snapshot", ("f", file));
+            FC_ASSERT(version == state_snapshot_version, "Unsupported version of state snapshot",
+                      ("version", version)("supported", state_snapshot_version));
+
+            my->file.seekg(0, std::ios::end);
+            uint64_t size = my->file.tellg();
+            my->payload_pos = sizeof(magic) + sizeof(version);
+            FC_ASSERT(size >= my->payload_pos + detail::state_snapshot_checksum_size, "State snapshot ${f} is truncated", ("f", file));
+            my->payload_end = size - detail::state_snapshot_checksum_size;
+            my->file.seekg(my->payload_pos);
+
+            std::memset(&my->stream, 0, sizeof(my->stream));
+            auto res = inflateInit(&my->stream);
+            FC_ASSERT(res == Z_OK, "Failed to initialize decompression of state snapshot", ("error", res));
+            my->buffer.resize(detail::state_snapshot_buffer_size);
+        }
+
+        state_snapshot_reader::~state_snapshot_reader() {
+            inflateEnd(&my->stream);
+        }
+
+        void state_snapshot_reader::read(char *data, size_t size) {
+            my->stream.next_out = reinterpret_cast<Bytef *>(data);
+            my->stream.avail_out = size;
+
+            while (my->stream.avail_out) {
+                my->inflate_buffer();
+            }
+
+            my->checksum.write(data, size);
+            my->raw_size += size;
+        }
+
+        void state_snapshot_reader::finish() {
+            // the payload has been read, only the end of the compressed stream may be left
+            char tail;
+            while (!my->stream_end) {
+                my->stream.next_out = reinterpret_cast<Bytef *>(&tail);
+                my->stream.avail_out = 1;
+                my->inflate_buffer();
+                FC_ASSERT(my->stream.avail_out == 1, "State snapshot has unexpected data");
+            }
+
+            fc::sha256 expected;
+            my->file.seekg(my->payload_end);
+            my->file.read(expected.data(), expected.data_size());
+            FC_ASSERT(my->file.good(), "Failed to read checksum of state snapshot");
+            FC_ASSERT(my->checksum.result() == expected, "Checksum of state snapshot doesn't match");
+        }
+
+        uint64_t state_snapshot_reader::raw_size() const {
+            return my->raw_size;
+        }
+
+    }
+} // golos::chain
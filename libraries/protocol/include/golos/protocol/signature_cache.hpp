@@ -0,0 +1,67 @@
+#pragma once
+
+#include <golos/protocol/types.hpp>
+
+#include <memory>
+
+namespace golos {
+    namespace protocol {
+
+        namespace detail { class signature_keys_cache_impl; }
+
+        struct signature_keys_cache_stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint32_t size = 0;
+            uint32_t max_size = 0;
+        };
+
+        /**
+         * Keeps the public keys recovered from transaction signatures, so a transaction that comes
+         * through push_transaction, then inside a block and then again while pending transactions are
+         * re-applied has its signatures recovered only once.
+         *
+         * Entries are keyed by the signature digest of the transaction, which covers the chain id.
+         * The digest doesn't include the signatures, so the signatures are stored along with the keys
+         * and compared on lookup. The least recently used entries are evicted when the cache is full.
+         *
+         * The cache is shared by all threads and is consulted by signed_transaction::get_signature_keys.
+         */
+        class signature_keys_cache final {
+        public:
+            static signature_keys_cache &instance();
+
+            ~signature_keys_cache();
+
+            /**
+             * Set the maximum number of cached transactions, 0 disables the cache
+             */
+            void set_max_size(uint32_t max_size);
+
+            /**
+             * False when the cache is disabled, then keys recovered in advance would be thrown away
+             */
+            bool enabled() const;
+
+            bool find(const digest_type &sig_digest, const vector<signature_type> &signatures,
+                      flat_set<public_key_type> &keys);
+
+            void store(const digest_type &sig_digest, const vector<signature_type> &signatures,
+                       const flat_set<public_key_type> &keys);
+
+            void clear();
+
+            signature_keys_cache_stats get_stats() const;
+
+            static const uint32_t default_max_size = 50000;
+
+        private:
+            signature_keys_cache();
+
+            std::unique_ptr<detail::signature_keys_cache_impl> my;
+        };
+
+    }
+} // golos::protocol
+
+FC_REFLECT((golos::protocol::signature_keys_cache_stats), (hits)(misses)(size)(max_size))
@@ -0,0 +1,130 @@
+#include <golos/protocol/signature_cache.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <mutex>
+
+namespace golos {
+    namespace protocol {
+
+        namespace detail {
+            using namespace boost::multi_index;
+
+            struct signature_keys_entry {
+                digest_type digest;
+                vector<signature_type> signatures;
+                flat_set<public_key_type> keys;
+            };
+
+            struct by_digest;
+
+            typedef multi_index_container<
+                signature_keys_entry,
+                indexed_by<
+                    sequenced<>,
+                    hashed_unique<tag<by_digest>,
+                        member<signature_keys_entry, digest_type, &signature_keys_entry::digest>,
+                        std::hash<digest_type>>>
+            > signature_keys_index;
+
+            class signature_keys_cache_impl {
+            public:
+                mutable std::mutex mutex;
+                signature_keys_index entries;
+                uint32_t max_size = signature_keys_cache::default_max_size;
+
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+
+                void shrink(uint32_t size) {
+                    while (entries.size() > size) {
+                        entries.pop_back();
+                    }
+                }
+            };
+        }
+
+        signature_keys_cache::signature_keys_cache()
+                : my(new detail::signature_keys_cache_impl()) {
+        }
+
+        signature_keys_cache::~signature_keys_cache() {
+        }
+
+        signature_keys_cache &signature_keys_cache::instance() {
+            static signature_keys_cache cache;
+            return cache;
+        }
+
+        void signature_keys_cache::set_max_size(uint32_t max_size) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            my->max_size = max_size;
+            my->shrink(max_size);
+        }
+
+        bool signature_keys_cache::enabled() const {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            return my->max_size != 0;
+        }
+
+        bool signature_keys_cache::find(
+            const digest_type &sig_digest, const vector<signature_type> &signatures, flat_set<public_key_type> &keys
+        ) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            auto &idx = my->entries.get<detail::by_digest>();
+            auto itr = idx.find(sig_digest);
+            if (itr == idx.end() || itr->signatures != signatures) {
+                ++my->misses;
+                return false;
+            }
+
+            keys = itr->keys;
+            my->entries.relocate(my->entries.begin(), my->entries.project<0>(itr));
+            ++my->hits;
+            return true;
+        }
+
+        void signature_keys_cache::store(
+            const digest_type &sig_digest, const vector<signature_type> &signatures, const flat_set<public_key_type> &keys
+        ) {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            if (my->max_size == 0) {
+                return;
+            }
+
+            auto &idx = my->entries.get<detail::by_digest>();
+            auto itr = idx.find(sig_digest);
+            if (itr != idx.end()) {
+                // the same transaction with other signatures, keep the latest one
+                idx.modify(itr, [&](detail::signature_keys_entry &e) {
+                    e.signatures = signatures;
+                    e.keys = keys;
+                });
+                my->entries.relocate(my->entries.begin(), my->entries.project<0>(itr));
+                return;
+            }
+
+            my->entries.push_front(detail::signature_keys_entry{sig_digest, signatures, keys});
+            my->shrink(my->max_size);
+        }
+
+        void signature_keys_cache::clear() {
+            std::lock_guard<std::mutex> lock(my->mutex);
+            my->entries.clear();
+        }
+
+        signature_keys_cache_stats signature_keys_cache::get_stats() const {
+            signature_keys_cache_stats stats;
+            std::lock_guard<std::mutex> lock(my->mutex);
+            stats.hits = my->hits;
+            stats.misses = my->misses;
+            stats.size = my->entries.size();
+            stats.max_size = my->max_size;
+            return stats;
+        }
+
+    }
+} // golos::protocol
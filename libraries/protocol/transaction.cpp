@@ -1,6 +1,7 @@
 
 #include <golos/protocol/transaction.hpp>
 #include <golos/protocol/exceptions.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -169,12 +170,18 @@ namespace golos {
             try {
                 auto d = sig_digest(chain_id);
                 flat_set<public_key_type> result;
+                auto &cache = signature_keys_cache::instance();
+                if (cache.find(d, signatures, result)) {
+                    return result;
+                }
+
                 for (const auto &sig : signatures) {
                     STEEMIT_ASSERT(
                             result.insert(fc::ecc::public_key(sig, d)).second,
                             tx_duplicate_sig,
                             "Duplicate Signature detected");
                 }
+                cache.store(d, signatures, result);
                 return result;
             } FC_CAPTURE_AND_RETHROW()
         }
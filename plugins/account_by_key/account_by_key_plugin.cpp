@@ -242,8 +242,8 @@ namespace golos {
                     my.reset(new account_by_key_plugin_impl(*this));
                     golos::chain::database &db = appbase::app().get_plugin<golos::plugins::chain::plugin>().db();
 
-                    db.pre_apply_operation.connect([&](const operation_notification &o) { my->pre_operation(o); });
-                    db.post_apply_operation.connect([&](const operation_notification &o) { my->post_operation(o); });
+                    db.connect_pre_apply_operation(name(), [&](const operation_notification &o) { my->pre_operation(o); });
+                    db.connect_post_apply_operation(name(), [&](const operation_notification &o) { my->post_operation(o); });
 
                     add_plugin_index<key_lookup_index>(db);
                     JSON_RPC_REGISTER_API ( name() ) ;
@@ -54,7 +54,7 @@ struct operation_visitor {
                 obj.trx_in_block = _note.trx_in_block;
                 obj.op_in_trx = _note.op_in_trx;
                 obj.virtual_op = _note.virtual_op;
-                obj.timestamp = _db.head_block_time();
+                obj.timestamp = _db.notification_time();
                 //fc::raw::pack( obj.serialized_op , _note.op);  //call to 'pack' is ambiguous
                 auto size = fc::raw::pack_size(_note.op);
                 obj.serialized_op.resize(size);
@@ -68,6 +68,9 @@ struct operation_visitor {
         if (hist_itr != hist_idx.end() &&
             hist_itr->account == item) {
                 sequence = hist_itr->sequence + 1;
+        } else if (_db.get_account_history_store()) {
+            // older operations of the account have been moved to the store
+            sequence = _db.get_account_history_store()->get_account_size(item);
         }
 
         _db.create<golos::chain::account_history_object>([&](golos::chain::account_history_object &ahist) {
@@ -179,6 +182,10 @@ public:
         flat_set<golos::chain::account_name_type> impacted;
         golos::chain::database &db = database();
 
+        if (db.get_account_history_store()) {
+            check_store();
+        }
+
         const golos::chain::operation_object *new_obj = nullptr;
         operation_get_impacted_accounts(note.op, impacted);
 
@@ -195,8 +202,72 @@ public:
         }
     }
 
+    /**
+     * Blocks of the store after the head of the state are written again when the state reaches them
+     */
+    void check_store() {
+        const auto &store = database().get_account_history_store();
+        if (_checked_store == store.get()) {
+            return;
+        }
+        _checked_store = store.get();
+
+        auto head_block_num = database().head_block_num();
+        if (head_block_num < store->head_block()) {
+            wlog("State is at block ${h} and the account history store is at block ${s}, the store is truncated",
+                 ("h", head_block_num)("s", store->head_block()));
+            store->truncate(head_block_num);
+        }
+    }
+
+    /**
+     * Move history of the irreversible blocks from chainbase to the store of the database
+     */
+    void on_applied_block() {
+        golos::chain::database &db = database();
+        const auto &store = db.get_account_history_store();
+        if (!store) {
+            return;
+        }
+        check_store();
+
+        auto last_irreversible_block_num = db.last_non_undoable_block_num();
+        auto store_head_block = store->head_block();
+        const auto &hist_idx = db.get_index<golos::chain::account_history_index>().indices().get<golos::chain::by_id>();
+
+        golos::chain::account_history_record record;
+        while (!hist_idx.empty()) {
+            const auto &op = db.get(hist_idx.begin()->op);
+            if (op.block > last_irreversible_block_num) {
+                break;
+            }
+
+            // history objects of an operation are created one after another
+            record.accounts.clear();
+            for (auto itr = hist_idx.begin(); itr != hist_idx.end() && itr->op == op.id; itr = hist_idx.begin()) {
+                record.accounts.emplace_back(itr->account, itr->sequence);
+                db.remove(*itr);
+            }
+
+            // objects of the operations moved earlier come back when the block which moved them is popped
+            if (op.block > store_head_block) {
+                record.trx_id = op.trx_id;
+                record.block = op.block;
+                record.trx_in_block = op.trx_in_block;
+                record.op_in_trx = op.op_in_trx;
+                record.virtual_op = op.virtual_op;
+                record.timestamp = op.timestamp;
+                record.serialized_op.assign(op.serialized_op.begin(), op.serialized_op.end());
+                store->append(record);
+            }
+            db.remove(op);
+        }
+        store->flush();
+    }
+
     flat_map<string, string> _tracked_accounts;
     bool _filter_content = false;
+    const golos::chain::account_history_store *_checked_store = nullptr;
     golos::chain::database & database_;
 };
 
@@ -406,7 +477,17 @@ void plugin::set_program_options(
 ) {
     cli.add_options()
             ("track-account-range", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(), "Defines a range of accounts to track as a json pair [\"from\",\"to\"] [from,to]")
-            ("filter-posting-ops", "Ignore posting operations, only track transfers and account updates");
+            ("filter-posting-ops", "Ignore posting operations, only track transfers and account updates")
+            ("account-history-store", boost::program_options::value<std::string>()->default_value("chainbase"),
+                "Where the account history is kept: chainbase - in the shared memory, "
+                "file - history of the irreversible blocks is moved to append-only segment files. "
+                "get_ops_in_block reads the irreversible blocks from the files, "
+                "get_transaction finds only the transactions of the reversible blocks")
+            ("account-history-dir", boost::program_options::value<boost::filesystem::path>()->default_value("account_history"),
+                "The location of the account history segment files (absolute path or relative to application data dir)")
+            ("account-history-segment-size", boost::program_options::value<uint32_t>()->default_value(
+                golos::chain::account_history_store::default_segment_size),
+                "Number of account history entries in a segment file");
     cfg.add(cli);
 }
 
@@ -414,13 +495,30 @@ void plugin::plugin_initialize(const boost::program_options::variables_map &opti
     ilog("account_history plugin: plugin_initialize() begin");
     my.reset(new plugin_impl);
     // auto & tmp_db_ref = appbase::app().get_plugin<chain::plugin>().db();
-    my->database().pre_apply_operation.connect([&](const golos::chain::operation_notification &note) { my->on_operation(note); });
+    // handlers read only the operation and the account history objects
+    my->database().allow_async_indexing(name());
+    my->database().connect_pre_apply_operation(name(), [&](const golos::chain::operation_notification &note) { my->on_operation(note); });
 
     typedef pair<string, string> pairstring;
     LOAD_VALUE_SET(options, "track-account-range", my->_tracked_accounts, pairstring);
     if (options.count("filter-posting-ops")) {
         my->_filter_content = true;
     }
+
+    auto store = options.at("account-history-store").as<std::string>();
+    FC_ASSERT(store == "chainbase" || store == "file", "Unknown account-history-store ${s}", ("s", store));
+    if (store == "file") {
+        auto dir = options.at("account-history-dir").as<boost::filesystem::path>();
+        if (dir.is_relative()) {
+            dir = appbase::app().data_dir() / dir;
+        }
+
+        auto history_store = std::make_shared<golos::chain::account_history_store>(
+            options.at("account-history-segment-size").as<uint32_t>());
+        history_store->open(dir);
+        my->database().set_account_history_store(history_store);
+    }
+    my->database().connect_applied_block(name(), [&](const signed_block &) { my->on_applied_block(); });
     ilog("account_history plugin: plugin_initialize() end");
     // init(options);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <golos/chain/steem_object_types.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
 
 namespace golos {
 namespace plugins {
@@ -37,3 +38,6 @@ FC_REFLECT( (golos::plugins::block_info::block_with_info),
     (block)
     (info)
 )
+
+JSON_STREAM_REFLECTED(golos::plugins::block_info::block_info)
+JSON_STREAM_REFLECTED(golos::plugins::block_info::block_with_info)
@@ -138,7 +138,7 @@ void plugin::plugin_initialize(const boost::program_options::variables_map &opti
 
     my.reset(new plugin_impl);
 
-    my->applied_block_conn_ = db.applied_block.connect([this](const protocol::signed_block &b) {
+    my->applied_block_conn_ = db.connect_applied_block(name(), [this](const protocol::signed_block &b) {
         on_applied_block(b);
     });
 
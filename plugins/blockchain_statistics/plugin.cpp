@@ -520,15 +520,15 @@ void plugin::plugin_initialize(const boost::program_options::variables_map &opti
         } // If it's not configured, then we've got some troubles...
         _my->stat_sender = std::shared_ptr<statistics_sender>(new statistics_sender(statsd_default_port) );
 
-        db.applied_block.connect([&](const signed_block &b) {
+        db.connect_applied_block(name(), [&](const signed_block &b) {
             _my->on_block(b);
         });
         
-        db.pre_apply_operation.connect([&](const operation_notification &o) {
+        db.connect_pre_apply_operation(name(), [&](const operation_notification &o) {
             _my->pre_operation(o);
         });
 
-        db.post_apply_operation.connect([&](const operation_notification &o) {
+        db.connect_post_apply_operation(name(), [&](const operation_notification &o) {
             _my->post_operation(o);
         });
 
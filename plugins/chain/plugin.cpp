@@ -5,8 +5,12 @@
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
 
+#include <boost/asio/deadline_timer.hpp>
+
 #include <iostream>
+#include <set>
 #include <golos/protocol/protocol.hpp>
+#include <golos/protocol/signature_cache.hpp>
 #include <golos/protocol/types.hpp>
 
 namespace golos {
@@ -25,8 +29,20 @@ namespace chain {
         bool resync = false;
         bool readonly = false;
         bool check_locks = false;
+        boost::filesystem::path snapshot_import;
+        boost::filesystem::path snapshot_export;
         bool validate_invariants = false;
         uint32_t flush_interval = 0;
+        uint32_t replay_queue_size = 1024;
+        uint32_t signature_recovery_threads = 2;
+        uint32_t signature_cache_size = protocol::signature_keys_cache::default_max_size;
+        bool incremental_pending = false;
+        uint32_t postponed_transactions_apply_time = 10;
+        std::unique_ptr<boost::asio::deadline_timer> postponed_transactions_timer;
+        std::set<std::string> async_indexing_plugins;
+        uint32_t async_indexing_queue_size = 1000;
+        uint32_t async_indexing_batch_size = 100;
+        uint32_t block_cache_size = golos::chain::block_cache::default_max_size;
         flat_map<uint32_t, protocol::block_id_type> loaded_checkpoints;
 
         uint32_t allow_future_time = 5;
@@ -46,6 +62,9 @@ namespace chain {
         bool accept_block(const protocol::signed_block &block, bool currently_syncing, uint32_t skip);
         void accept_transaction(const protocol::signed_transaction &trx);
 
+        void schedule_postponed_transactions(const boost::posix_time::time_duration &delay);
+
+        void apply_postponed_transactions();
 
         golos::chain::database db;
     };
@@ -73,6 +92,25 @@ namespace chain {
         db.push_transaction(trx);
     }
 
+    void plugin::plugin_impl::schedule_postponed_transactions(const boost::posix_time::time_duration &delay) {
+        postponed_transactions_timer->expires_from_now(delay);
+        postponed_transactions_timer->async_wait([this](const boost::system::error_code &ec) {
+            if (ec != boost::asio::error::operation_aborted) {
+                apply_postponed_transactions();
+            }
+        });
+    }
+
+    void plugin::plugin_impl::apply_postponed_transactions() {
+        size_t left = 0;
+        try {
+            left = db.apply_postponed_transactions(fc::milliseconds(postponed_transactions_apply_time));
+        } FC_CAPTURE_AND_LOG(())
+
+        // keep going while there is something to apply, but let the block pushes take the lock in between
+        schedule_postponed_transactions(left ? boost::posix_time::milliseconds(1) : boost::posix_time::milliseconds(100));
+    }
+
     plugin::plugin() {
     }
 
@@ -96,12 +134,40 @@ namespace chain {
                                                                 boost::program_options::value<std::vector<std::string>>()->composing(),
                                                                 "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")(
                 "flush-state-interval", boost::program_options::value<uint32_t>(),
-                "flush shared memory changes to disk every N blocks");
+                "flush shared memory changes to disk every N blocks")(
+                "replay-queue-size", boost::program_options::value<uint32_t>()->default_value(1024),
+                "Number of blocks read ahead from block log while replaying the blockchain")(
+                "signature-recovery-threads", boost::program_options::value<uint32_t>()->default_value(2),
+                "Number of threads recovering signature keys of block transactions before the block is applied "
+                "(0 - recover them on the thread pushing the block)")(
+                "signature-cache-size", boost::program_options::value<uint32_t>()->default_value(
+                    protocol::signature_keys_cache::default_max_size),
+                "Number of transactions which recovered signature keys are cached (0 - disable the cache)")(
+                "incremental-pending-transactions", boost::program_options::value<bool>()->default_value(false),
+                "Don't re-apply all pending transactions after each block. Included and expired transactions are dropped, "
+                "the rest are re-applied in the background")(
+                "postponed-transactions-apply-time", boost::program_options::value<uint32_t>()->default_value(10),
+                "Max time in milliseconds the write lock is held while re-applying postponed pending transactions")(
+                "async-indexing-plugin", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(),
+                "Plugin which indexes applied blocks on the indexing thread instead of the block application "
+                "(account_history, market_history). Its handlers see the state after the block is applied, and never "
+                "see pending transactions, so plugins which read the chain state are rejected")(
+                "async-indexing-queue-size", boost::program_options::value<uint32_t>()->default_value(1000),
+                "Max number of applied blocks waiting for the indexing thread, after it blocks are indexed while they are applied")(
+                "async-indexing-batch-size", boost::program_options::value<uint32_t>()->default_value(100),
+                "Max number of blocks the indexing thread indexes under one write lock")(
+                "block-cache-size", boost::program_options::value<uint32_t>()->default_value(
+                    golos::chain::block_cache::default_max_size),
+                "Number of blocks cached in memory for reads from the block log (0 - disable the cache)");
         cli.add_options()("replay-blockchain", boost::program_options::bool_switch()->default_value(false),
                           "clear chain database and replay all blocks")("resync-blockchain",
                                                                         boost::program_options::bool_switch()->default_value(
                                                                                 false),
                                                                         "clear chain database and block log")(
+                "snapshot-import", boost::program_options::value<boost::filesystem::path>(),
+                "clear chain database, load the state from the snapshot file and apply the rest of the block log")(
+                "snapshot-export", boost::program_options::value<boost::filesystem::path>(),
+                "write the state at the last irreversible block to the snapshot file on startup")(
                 "check-locks", boost::program_options::bool_switch()->default_value(false),
                 "Check correctness of chainbase locking")("validate-database-invariants",
                                                           boost::program_options::bool_switch()->default_value(false),
@@ -127,6 +193,12 @@ namespace chain {
         my->replay = options.at("replay-blockchain").as<bool>();
         my->resync = options.at("resync-blockchain").as<bool>();
         my->check_locks = options.at("check-locks").as<bool>();
+        if (options.count("snapshot-import")) {
+            my->snapshot_import = options.at("snapshot-import").as<boost::filesystem::path>();
+        }
+        if (options.count("snapshot-export")) {
+            my->snapshot_export = options.at("snapshot-export").as<boost::filesystem::path>();
+        }
         my->validate_invariants = options.at("validate-database-invariants").as<bool>();
         if (options.count("flush-state-interval")) {
             my->flush_interval = options.at("flush-state-interval").as<uint32_t>();
@@ -134,6 +206,24 @@ namespace chain {
             my->flush_interval = 10000;
         }
 
+        my->replay_queue_size = options.at("replay-queue-size").as<uint32_t>();
+        my->signature_recovery_threads = options.at("signature-recovery-threads").as<uint32_t>();
+        my->signature_cache_size = options.at("signature-cache-size").as<uint32_t>();
+        my->incremental_pending = options.at("incremental-pending-transactions").as<bool>();
+        my->postponed_transactions_apply_time = options.at("postponed-transactions-apply-time").as<uint32_t>();
+
+        if (options.count("async-indexing-plugin")) {
+            for (const auto &name : options.at("async-indexing-plugin").as<std::vector<std::string>>()) {
+                my->async_indexing_plugins.insert(name);
+            }
+        }
+        my->async_indexing_queue_size = options.at("async-indexing-queue-size").as<uint32_t>();
+        my->async_indexing_batch_size = options.at("async-indexing-batch-size").as<uint32_t>();
+        my->block_cache_size = options.at("block-cache-size").as<uint32_t>();
+        // plugins connect their handlers in plugin_initialize(), which is called after this one
+        my->db.set_async_indexing(
+            my->async_indexing_plugins, my->async_indexing_queue_size, my->async_indexing_batch_size);
+
         if (options.count("checkpoint")) {
             auto cps = options.at("checkpoint").as<std::vector<std::string>>();
             my->loaded_checkpoints.reserve(cps.size());
@@ -153,10 +243,18 @@ namespace chain {
         }
 
         my->db.set_flush_interval(my->flush_interval);
+        my->db.set_replay_queue_size(my->replay_queue_size);
+        my->db.set_signature_recovery_threads(my->signature_recovery_threads);
+        protocol::signature_keys_cache::instance().set_max_size(my->signature_cache_size);
+        my->db.set_incremental_pending(my->incremental_pending);
+        my->db.set_block_cache_size(my->block_cache_size);
         my->db.add_checkpoints(my->loaded_checkpoints);
         my->db.set_require_locking(my->check_locks);
 
-        if (my->replay) {
+        if (!my->snapshot_import.empty()) {
+            my->db.import_state(appbase::app().data_dir() / "blockchain", my->shared_memory_dir, my->shared_memory_size,
+                                my->snapshot_import);
+        } else if (my->replay) {
             ilog("Replaying blockchain on user request.");
             my->db.reindex(appbase::app().data_dir() / "blockchain", my->shared_memory_dir, my->shared_memory_size);
         } else {
@@ -176,10 +274,30 @@ namespace chain {
         }
 
         ilog("Started on blockchain with ${n} blocks", ("n", my->db.head_block_num()));
+
+        if (!my->snapshot_export.empty()) {
+            // open() and reindex() leave the state at the last irreversible block
+            my->db.export_state(my->snapshot_export);
+        }
+
+        if (!my->async_indexing_plugins.empty()) {
+            my->db.start_async_indexing();
+        }
+
+        if (my->incremental_pending) {
+            my->postponed_transactions_timer.reset(new boost::asio::deadline_timer(appbase::app().get_io_service()));
+            my->schedule_postponed_transactions(boost::posix_time::milliseconds(100));
+        }
         on_sync();
     }
 
     void plugin::plugin_shutdown() {
+        if (my->postponed_transactions_timer) {
+            my->postponed_transactions_timer->cancel();
+        }
+
+        my->db.stop_async_indexing();
+
         ilog("closing chain database");
         my->db.close();
         ilog("database closed successfully");
@@ -9,7 +9,9 @@
 
 #include <boost/range/iterator_range.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <memory>
+#include <tuple>
 #include <golos/plugins/json_rpc/plugin.hpp>
 
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
@@ -286,6 +288,24 @@ namespace golos {
                     }
                     ++itr;
                 }
+
+                // operations of the irreversible blocks are moved from chainbase to the store
+                const auto &store = database().get_account_history_store();
+                if (store && block_num <= store->head_block()) {
+                    auto chainbase_size = result.size();
+                    store->get_block_history(block_num, [&](const account_history_record &record) {
+                        temp = applied_operation(record);
+                        if (!only_virtual || is_virtual_operation(temp.op)) {
+                            result.push_back(temp);
+                        }
+                    });
+                    if (chainbase_size && chainbase_size < result.size()) {
+                        std::sort(result.begin(), result.end(), [](const applied_operation &a, const applied_operation &b) {
+                            return std::tie(a.trx_in_block, a.op_in_trx, a.virtual_op) <
+                                   std::tie(b.trx_in_block, b.op_in_trx, b.virtual_op);
+                        });
+                    }
+                }
                 return result;
             }
 
@@ -342,6 +362,10 @@ namespace golos {
                 return golos::protocol::get_config();
             }
 
+            DEFINE_API(plugin, get_signature_cache_stats) {
+                return golos::protocol::signature_keys_cache::instance().get_stats();
+            }
+
             DEFINE_API(plugin, get_dynamic_global_properties) {
                 return my->database().with_read_lock([&]() {
                     return my->get_dynamic_global_properties();
@@ -897,17 +921,37 @@ namespace golos {
                 FC_ASSERT(limit <= 10000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
                 FC_ASSERT(from >= limit, "From must be greater than limit");
                 //   idump((account)(from)(limit));
+                const auto &store = database().get_account_history_store();
                 const auto &idx = database().get_index<account_history_index>().indices().get<by_account>();
                 auto itr = idx.lower_bound(boost::make_tuple(account, from));
                 //   if( itr != idx.end() ) idump((*itr));
-                auto end = idx.upper_bound(boost::make_tuple(account, std::max(int64_t(0), int64_t(itr->sequence) - limit)));
-                //   if( end != idx.end() ) idump((*end));
 
                 std::map<uint32_t, applied_operation> result;
-                while (itr != end) {
+                int64_t last;
+                if (itr != idx.end() && itr->account == account) {
+                    last = itr->sequence;
+                } else if (store) {
+                    // the recent operations of the account are irreversible, all of them are in the store
+                    last = std::min<int64_t>(from, int64_t(store->get_account_size(account)) - 1);
+                } else {
+                    return result;
+                }
+                auto first = std::max(int64_t(0), last - limit);
+
+                while (itr != idx.end() && itr->account == account && itr->sequence >= first) {
                     result[itr->sequence] = database().get(itr->op);
                     ++itr;
                 }
+
+                // older operations are moved from chainbase to the store
+                if (store && last >= 0) {
+                    auto store_last = result.empty() ? last : int64_t(result.begin()->first) - 1;
+                    if (store_last >= first) {
+                        store->get_history(account, first, store_last, [&](uint32_t sequence, const account_history_record &record) {
+                            result[sequence] = applied_operation(record);
+                        });
+                    }
+                }
                 return result;
             }
 
@@ -1008,6 +1052,10 @@ namespace golos {
                         result.transaction_num = itr->trx_in_block;
                         return result;
                     }
+                    // only operations of the reversible blocks are left in chainbase
+                    FC_ASSERT(!my->database().get_account_history_store(),
+                              "Unknown Transaction ${t}, transactions of the irreversible blocks can't be found "
+                              "with account-history-store = file", ("t", id));
                     FC_ASSERT(false, "Unknown Transaction ${t}", ("t", id));
                 });
             }
@@ -1017,7 +1065,7 @@ namespace golos {
                 ilog("database_api plugin: plugin_initialize() begin");
                 my = std::make_unique<api_impl>();
                 JSON_RPC_REGISTER_API(plugin_name)
-                my->database().applied_block.connect([this](const protocol::signed_block &) {
+                my->database().connect_applied_block(plugin_name, [this](const protocol::signed_block &) {
                     this->clear_block_applied_callback();
                 });
                 ilog("database_api plugin: plugin_initialize() end");
@@ -14,6 +14,12 @@ namespace golos {
                 op = fc::raw::unpack<protocol::operation>(op_obj.serialized_op);
             }
 
+            applied_operation::applied_operation(const chain::account_history_record &record) : trx_id(record.trx_id),
+                    block(record.block), trx_in_block(record.trx_in_block), op_in_trx(record.op_in_trx),
+                    virtual_op(record.virtual_op), timestamp(record.timestamp) {
+                op = fc::raw::unpack<protocol::operation>(record.serialized_op);
+            }
+
         }
     }
 }
@@ -3,6 +3,8 @@
 #include <golos/protocol/operations.hpp>
 #include <golos/chain/steem_object_types.hpp>
 #include <golos/chain/history_object.hpp>
+#include <golos/chain/account_history_store.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
 
 namespace golos {
     namespace plugins {
@@ -13,6 +15,8 @@ namespace golos {
 
                 applied_operation(const golos::chain::operation_object &op_obj);
 
+                applied_operation(const golos::chain::account_history_record &record);
+
                 golos::protocol::transaction_id_type trx_id;
                 uint32_t block = 0;
                 uint32_t trx_in_block = 0;
@@ -27,3 +31,4 @@ namespace golos {
 }
 
 FC_REFLECT((golos::plugins::database_api::applied_operation), (trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(op))
+JSON_STREAM_REFLECTED(golos::plugins::database_api::applied_operation)
@@ -16,6 +16,7 @@
 #include <golos/plugins/database_api/api_objects/account_recovery_request_api_object.hpp>
 #include <golos/plugins/database_api/api_objects/savings_withdraw_api_object.hpp>
 #include <golos/plugins/chain/plugin.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include "forward.hpp"
 
@@ -110,6 +111,7 @@ namespace golos {
             DEFINE_API_ARGS(get_ops_in_block,                 msg_pack, std::vector<applied_operation>)
             DEFINE_API_ARGS(set_block_applied_callback,       msg_pack, void_type)
             DEFINE_API_ARGS(get_config,                       msg_pack, variant_object)
+            DEFINE_API_ARGS(get_signature_cache_stats,        msg_pack, golos::protocol::signature_keys_cache_stats)
             DEFINE_API_ARGS(get_dynamic_global_properties,    msg_pack, dynamic_global_property_api_object)
             DEFINE_API_ARGS(get_chain_properties,             msg_pack, chain_properties_17)
             DEFINE_API_ARGS(get_current_median_history_price, msg_pack, price_17)
@@ -258,6 +260,11 @@ namespace golos {
                                      */
                                     (get_config)
 
+                                    /**
+                                     * @brief Retrieve hits and misses of the cache of keys recovered from transaction signatures
+                                     */
+                                    (get_signature_cache_stats)
+
                                     /**
                                      * @brief Retrieve the current @ref dynamic_global_property_object
                                      */
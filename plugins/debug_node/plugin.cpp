@@ -123,7 +123,7 @@ void plugin::plugin_initialize( const boost::program_options::variables_map& opt
     }
 
     // connect needed signals
-    my->applied_block_connection = my->database().applied_block.connect( [this](const golos::chain::signed_block& b){
+    my->applied_block_connection = my->database().connect_applied_block( name(), [this](const golos::chain::signed_block& b){
         my->on_applied_block(b);
     });
 
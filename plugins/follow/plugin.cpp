@@ -381,10 +381,10 @@ namespace golos {
                     auto &db = pimpl->database();
                     pimpl->plugin_initialize(*this);
 
-                    db.pre_apply_operation.connect([&](const operation_notification &o) {
+                    db.connect_pre_apply_operation(name(), [&](const operation_notification &o) {
                         pimpl->pre_operation(o, *this);
                     });
-                    db.post_apply_operation.connect([&](const operation_notification &o) {
+                    db.connect_post_apply_operation(name(), [&](const operation_notification &o) {
                         pimpl->post_operation(o, *this);
                     });
                     golos::chain::add_plugin_index<follow_index>(db);
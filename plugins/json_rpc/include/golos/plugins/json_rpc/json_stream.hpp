@@ -0,0 +1,199 @@
+#pragma once
+
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace golos {
+    namespace protocol {
+        struct signed_transaction;
+        struct signed_block;
+    }
+
+    namespace plugins {
+        namespace json_rpc {
+
+            /**
+             * Types which json representation is made by their reflection, i.e. they don't have
+             * a custom to_variant(). json_stream writes them field by field, use JSON_STREAM_REFLECTED
+             * to mark a type.
+             */
+            template<typename T>
+            struct json_stream_reflected : std::false_type {
+            };
+
+            // blocks are the biggest part of the block API results, they are declared here to be the same for all of them
+            template<>
+            struct json_stream_reflected<golos::protocol::signed_transaction> : std::true_type {
+            };
+
+            template<>
+            struct json_stream_reflected<golos::protocol::signed_block> : std::true_type {
+            };
+
+            /**
+             * Results of these types are written by json_stream instead of converting to fc::variant
+             */
+            template<typename T>
+            struct is_json_streamable : json_stream_reflected<T> {
+            };
+
+            template<typename T, typename A>
+            struct is_json_streamable<std::vector<T, A>> : is_json_streamable<T> {
+            };
+
+            template<typename K, typename V, typename C, typename A>
+            struct is_json_streamable<std::map<K, V, C, A>> : is_json_streamable<V> {
+            };
+
+            template<typename T>
+            struct is_json_streamable<fc::optional<T>> : is_json_streamable<T> {
+            };
+
+            /**
+             * Writes json into a string directly from the structs, without the intermediate fc::variant tree.
+             * The output is the same as fc::json::to_string(fc::variant(value)): reflected types and containers
+             * of them are written here, other values (strings, numbers, assets, operations ...) are small
+             * and go through fc::variant.
+             */
+            class json_stream final {
+            public:
+                explicit json_stream(std::string &out)
+                        : _out(out) {
+                }
+
+                template<typename T>
+                void write(const T &value) {
+                    write(value, json_stream_reflected<T>());
+                }
+
+                template<typename T, typename A>
+                void write(const std::vector<T, A> &value) {
+                    if (!is_json_streamable<T>::value) {
+                        return write_variant(value);
+                    }
+                    _out += '[';
+                    bool first = true;
+                    for (const auto &item : value) {
+                        if (!first) {
+                            _out += ',';
+                        }
+                        first = false;
+                        write(item);
+                    }
+                    _out += ']';
+                }
+
+                /// maps are arrays of [key, value] pairs
+                template<typename K, typename V, typename C, typename A>
+                void write(const std::map<K, V, C, A> &value) {
+                    if (!is_json_streamable<V>::value) {
+                        return write_variant(value);
+                    }
+                    _out += '[';
+                    bool first = true;
+                    for (const auto &item : value) {
+                        if (!first) {
+                            _out += ',';
+                        }
+                        first = false;
+                        _out += '[';
+                        write(item.first);
+                        _out += ',';
+                        write(item.second);
+                        _out += ']';
+                    }
+                    _out += ']';
+                }
+
+                template<typename T>
+                void write(const fc::optional<T> &value) {
+                    if (!value.valid()) {
+                        _out += "null";
+                        return;
+                    }
+                    write(*value);
+                }
+
+            private:
+                template<typename Class>
+                class member_visitor {
+                public:
+                    member_visitor(json_stream &stream, const Class &obj)
+                            : _stream(stream), _obj(obj) {
+                    }
+
+                    template<typename Member, class Base, Member (Base::*member)>
+                    void operator()(const char *name) const {
+                        add(name, _obj.*member);
+                    }
+
+                private:
+                    // like to_variant() of the reflected types, empty optional members are omitted
+                    template<typename M>
+                    void add(const char *name, const fc::optional<M> &value) const {
+                        if (value.valid()) {
+                            add(name, *value);
+                        }
+                    }
+
+                    template<typename M>
+                    void add(const char *name, const M &value) const {
+                        if (!_first) {
+                            _stream._out += ',';
+                        }
+                        _first = false;
+                        _stream._out += '"';
+                        _stream._out += name;
+                        _stream._out += "\":";
+                        _stream.write(value);
+                    }
+
+                    json_stream &_stream;
+                    const Class &_obj;
+                    mutable bool _first = true;
+                };
+
+                template<typename T>
+                void write(const T &value, std::true_type) {
+                    _out += '{';
+                    fc::reflector<T>::visit(member_visitor<T>(*this, value));
+                    _out += '}';
+                }
+
+                template<typename T>
+                void write(const T &value, std::false_type) {
+                    write_variant(value);
+                }
+
+                template<typename T>
+                void write_variant(const T &value) {
+                    _out += fc::json::to_string(fc::variant(value));
+                }
+
+                std::string &_out;
+            };
+
+            template<typename T>
+            std::string to_json_string(const T &value) {
+                std::string out;
+                json_stream(out).write(value);
+                return out;
+            }
+
+        }
+    }
+} // golos::plugins::json_rpc
+
+#define JSON_STREAM_REFLECTED(TYPE)                                                  \
+namespace golos { namespace plugins { namespace json_rpc {                           \
+    template<>                                                                       \
+    struct json_stream_reflected<TYPE> : std::true_type {                            \
+    };                                                                               \
+} } }
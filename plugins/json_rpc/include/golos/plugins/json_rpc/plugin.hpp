@@ -2,6 +2,7 @@
 
 #include <appbase/application.hpp>
 #include <golos/plugins/json_rpc/utility.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
 #include <fc/variant.hpp>
 #include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
@@ -92,8 +93,7 @@ namespace golos {
                 APPBASE_PLUGIN_REQUIRES();
 
                 void set_program_options(boost::program_options::options_description &,
-                                         boost::program_options::options_description &) override {
-                }
+                                         boost::program_options::options_description &) override;
 
                 static const std::string &name() {
                     static std::string name = STEEM_JSON_RPC_PLUGIN_NAME;
@@ -111,6 +111,12 @@ namespace golos {
 
                 void call(const string &body, response_handler_type);
 
+                /**
+                 * Answer every request of the body with the error without calling the API, the responses
+                 * keep the ids of the requests. Used when the server can't take the request, e.g. is overloaded.
+                 */
+                void reject(const string &body, int32_t code, const string &message, response_handler_type);
+
             private:
                 class impl;
 
@@ -118,6 +124,30 @@ namespace golos {
             };
 
             namespace detail {
+                template<typename Plugin, typename Method>
+                api_method make_api_method(Plugin &plugin, Method method, std::false_type) {
+                    return [&plugin, method](msg_pack &args) -> fc::variant {
+                        return fc::variant((plugin.*method)(args));
+                    };
+                }
+
+                /**
+                 * The result is written to json by json_stream and passed to the connection here
+                 */
+                template<typename Plugin, typename Method>
+                api_method make_api_method(Plugin &plugin, Method method, std::true_type) {
+                    return [&plugin, method](msg_pack &args) -> fc::variant {
+                        auto result = (plugin.*method)(args);
+                        if (args.valid()) {
+                            auto json = to_json_string(result);
+                            // json_rpc doesn't pass a result of the moved msg_pack
+                            msg_pack msg(std::move(args));
+                            msg.raw_result(std::move(json));
+                        }
+                        return fc::variant();
+                    };
+                }
+
                 class register_api_method_visitor {
                 public:
                     register_api_method_visitor(const std::string &api_name) : _api_name(api_name),
@@ -128,9 +158,7 @@ namespace golos {
                     void operator()(Plugin &plugin, const std::string &method_name, Method method, Args *args,
                                     Ret *ret) {
                         _json_rpc_plugin.add_api_method(_api_name, method_name,
-                                                        [&plugin, method](msg_pack &args) -> fc::variant {
-                                                            return fc::variant((plugin.*method)(args));
-                                                        });
+                                                        make_api_method(plugin, method, is_json_streamable<Ret>()));
                         /*api_method_signature{ fc::variant( Args() ), fc::variant( Ret() ) }*/ //);
                     }
 
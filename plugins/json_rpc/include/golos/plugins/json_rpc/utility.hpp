@@ -75,6 +75,9 @@ namespace golos {
 
                 void unsafe_result(fc::optional<fc::variant> result);
 
+                // Pass result already written to json
+                void raw_result(std::string json);
+
                 fc::optional<fc::variant> result() const;
 
                 // Pass error to remote connection
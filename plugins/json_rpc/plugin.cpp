@@ -2,11 +2,18 @@
 #include <golos/plugins/json_rpc/utility.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/io_service.hpp>
 
 #include <fc/log/logger_config.hpp>
 #include <fc/exception/exception.hpp>
 #include <thirdparty/fc/vendor/websocketpp/websocketpp/error.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
 namespace golos {
     namespace plugins {
         namespace json_rpc {
@@ -28,8 +35,40 @@ namespace golos {
                 fc::optional<fc::variant> result;
                 fc::optional<json_rpc_error> error;
                 fc::variant id;
+                /// result written to json by json_stream, it is not reflected
+                fc::optional<std::string> raw_result;
             };
 
+            std::string to_json_string(const json_rpc_response &response) {
+                if (!response.raw_result.valid()) {
+                    return fc::json::to_string(response);
+                }
+
+                // the same fields in the same order as the reflected response has
+                std::string out;
+                out.reserve(response.raw_result->size() + 64);
+                out += "{\"jsonrpc\":";
+                out += fc::json::to_string(response.jsonrpc);
+                out += ",\"result\":";
+                out += *response.raw_result;
+                out += ",\"id\":";
+                out += fc::json::to_string(response.id);
+                out += '}';
+                return out;
+            }
+
+            std::string to_json_string(const vector<json_rpc_response> &responses) {
+                std::string out = "[";
+                for (size_t i = 0; i < responses.size(); ++i) {
+                    if (i) {
+                        out += ',';
+                    }
+                    out += to_json_string(responses[i]);
+                }
+                out += ']';
+                return out;
+            }
+
             struct msg_pack::impl final {
                 using handler_type = std::function<void (json_rpc_response &)>;
 
@@ -102,6 +141,18 @@ namespace golos {
                 }
             }
 
+            void msg_pack::raw_result(std::string json) {
+                // Pimpl can absent in case if msg_pack delegated its handlers to other msg_pack (see move constructor)
+                FC_ASSERT(valid(), "The msg_pack delegated its handlers");
+                pimpl->response.raw_result = std::move(json);
+                try {
+                    pimpl->handler(pimpl->response);
+                } catch (const websocketpp::exception &) {
+                    // Can't send data via socket -
+                    //    don't pass exception to upper level, because it doesn't have handler for exception
+                }
+            }
+
             fc::optional<fc::variant> msg_pack::result() const {
                 // Pimpl can absent in case if msg_pack delegated its handlers to other msg_pack (see move constructor)
                 if (valid()) {
@@ -142,6 +193,25 @@ namespace golos {
                 return fc::optional<std::string>();
             }
 
+            /**
+             * Requests of a batch and their responses in the order of the requests
+             */
+            struct batch_state {
+                vector<fc::variant> messages;
+                vector<json_rpc_response> responses;
+                plugin::response_handler_type response_handler;
+                /// requests which responses haven't been received yet
+                std::atomic<size_t> pending{0};
+                /// the next request to run, in the parallel mode requests are taken by several threads
+                std::atomic<size_t> next{0};
+                /// requests which calls have returned, the thread which started the batch waits for all of them
+                size_t returned = 0;
+                std::mutex mutex;
+                std::condition_variable returned_cv;
+            };
+
+            using batch_ptr = std::shared_ptr<batch_state>;
+
             using get_methods_args     = void_type;
             using get_methods_return   = vector<string>;
             using get_signature_args   = string;
@@ -153,6 +223,23 @@ namespace golos {
                 }
 
                 ~impl() {
+                    stop_batch_workers();
+                }
+
+                void start_batch_workers(uint32_t threads) {
+                    _batch_work.reset(new boost::asio::io_service::work(_batch_ios));
+                    for (uint32_t i = 0; i < threads; ++i) {
+                        _batch_threads.emplace_back([this]() { _batch_ios.run(); });
+                    }
+                }
+
+                void stop_batch_workers() {
+                    _batch_work.reset();
+                    _batch_ios.stop();
+                    for (auto &thread : _batch_threads) {
+                        thread.join();
+                    }
+                    _batch_threads.clear();
                 }
 
                 void add_api_method(const string &api_name, const string &method_name,
@@ -273,29 +360,135 @@ namespace golos {
                     }
                 }
 
-                void rpc(vector<fc::variant> messages, response_handler_type response_handler) {
-                    auto responses = std::make_shared<vector<json_rpc_response>>();
+                /**
+                 * Name of the API called by the request, empty if the request is malformed
+                 */
+                std::string get_api_name(const fc::variant &data) {
+                    try {
+                        const auto &request = data.get_object();
+                        auto method = request["method"].as_string();
+                        if (method == "call") {
+                            return request["params"].get_array().at(0).as_string();
+                        }
+                        return method.substr(0, method.find('.'));
+                    } catch (...) {
+                        return std::string();
+                    }
+                }
 
-                    responses->reserve(messages.size());
+                /**
+                 * Requests of the batch can run concurrently if they don't write to the database
+                 */
+                bool is_parallel_batch(const vector<fc::variant> &messages) {
+                    if (_batch_threads.empty() || messages.size() < 2) {
+                        return false;
+                    }
+                    for (const auto &message : messages) {
+                        if (_serial_apis.count(get_api_name(message))) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
 
-                    std::function<void()> next_handler = [response_handler, responses]{
-                        response_handler(fc::json::to_string(*responses.get()));
-                    };
+                void send_batch_response(const batch_ptr &batch) {
+                    try {
+                        batch->response_handler(to_json_string(batch->responses));
+                    } catch (const websocketpp::exception &) {
+                        // Can't send data via socket
+                    }
+                }
 
-                    for (auto it = messages.rbegin(); messages.rend() != it; ++it) {
-                        auto v = *it;
+                /**
+                 * Run requests one after another starting from the index. A request can pass its response
+                 * later from another thread (see msg_pack(msg_pack&&)), then the rest of the batch is
+                 * continued from that thread.
+                 */
+                void rpc_serial(const batch_ptr &batch, size_t index) {
+                    enum step_state { running, returned, responded };
+
+                    for (; index < batch->messages.size(); ++index) {
+                        auto state = std::make_shared<std::atomic<int>>(running);
+
+                        msg_pack msg([this, batch, index, state](json_rpc_response &response) {
+                            batch->responses[index] = std::move(response);
+                            if (index + 1 == batch->messages.size()) {
+                                send_batch_response(batch);
+                            } else if (state->exchange(responded) == returned) {
+                                rpc_serial(batch, index + 1);
+                            }
+                        });
+
+                        rpc(batch->messages[index], msg);
+
+                        if (index + 1 == batch->messages.size() || state->exchange(returned) != responded) {
+                            // the last request, or the response will continue the batch
+                            return;
+                        }
+                    }
+                }
+
+                /**
+                 * Run requests concurrently on this thread and the batch workers, the response is sent when
+                 * the last one is done. This thread returns when all calls of the batch have returned, so
+                 * the webserver executor accounts the batch as one request of the connection, and the next
+                 * request of the connection doesn't overtake it.
+                 *
+                 * The workers are asked for help by tasks in their queue, at most one task per worker is
+                 * queued at a time, the requests which aren't taken by the workers run on this thread.
+                 */
+                void rpc_parallel(const batch_ptr &batch) {
+                    batch->pending = batch->messages.size();
+                    auto helpers = std::min(batch->messages.size() - 1, _batch_threads.size());
+                    for (size_t i = 0; i < helpers; ++i) {
+                        if (_queued_helpers.fetch_add(1) >= _batch_threads.size()) {
+                            --_queued_helpers;
+                            break;
+                        }
+                        _batch_ios.post([this, batch]() {
+                            --_queued_helpers;
+                            rpc_batch_requests(batch);
+                        });
+                    }
+
+                    rpc_batch_requests(batch);
+
+                    std::unique_lock<std::mutex> lock(batch->mutex);
+                    batch->returned_cv.wait(lock, [&]() { return batch->returned == batch->messages.size(); });
+                }
+
+                /**
+                 * Take requests of the batch while there are any left
+                 */
+                void rpc_batch_requests(const batch_ptr &batch) {
+                    for (auto index = batch->next++; index < batch->messages.size(); index = batch->next++) {
+                        msg_pack msg([this, batch, index](json_rpc_response &response) {
+                            batch->responses[index] = std::move(response);
+                            if (--batch->pending == 0) {
+                                send_batch_response(batch);
+                            }
+                        });
 
-                        next_handler = [next_handler, responses, v, this]{
-                            msg_pack msg([next_handler, responses](json_rpc_response &response){
-                                responses->push_back(response);
-                                next_handler();
-                            });
+                        rpc(batch->messages[index], msg);
 
-                            this->rpc(v, msg);
-                        };
+                        std::lock_guard<std::mutex> lock(batch->mutex);
+                        if (++batch->returned == batch->messages.size()) {
+                            batch->returned_cv.notify_all();
+                        }
                     }
+                }
+
+                void rpc(vector<fc::variant> messages, response_handler_type response_handler) {
+                    auto batch = std::make_shared<batch_state>();
+                    batch->responses.resize(messages.size());
+                    batch->messages = std::move(messages);
+                    batch->response_handler = std::move(response_handler);
 
-                    next_handler();
+                    if (is_parallel_batch(batch->messages)) {
+                        rpc_parallel(batch);
+                    } else {
+                        rpc_serial(batch, 0);
+                    }
                 }
 
                 void initialize() {
@@ -322,7 +515,14 @@ namespace golos {
                 map<string, api_description> _registered_apis;
                 vector<string> _methods;
                 map<string, map<string, api_method_signature> > _method_sigs;
+                std::set<std::string> _serial_apis;
             private:
+                boost::asio::io_service _batch_ios;
+                std::unique_ptr<boost::asio::io_service::work> _batch_work;
+                std::vector<std::thread> _batch_threads;
+                /// tasks of the batches waiting for the workers
+                std::atomic<size_t> _queued_helpers{0};
+
                 // This is a reindex which allows to get parent plugin by method
                 // unordered_map[method] -> plugin
                 // For example:
@@ -338,10 +538,31 @@ namespace golos {
             plugin::~plugin() {
             }
 
+            void plugin::set_program_options(boost::program_options::options_description &,
+                                             boost::program_options::options_description &cfg) {
+                cfg.add_options()
+                    ("rpc-batch-threads", boost::program_options::value<uint32_t>()->default_value(0),
+                     "Number of threads helping to run requests of a batch concurrently, responses are returned in the "
+                     "order of the requests (0 - run requests of a batch one after another)")
+                    ("rpc-serial-api", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken()
+                        ->default_value(std::vector<std::string>{"network_broadcast_api", "debug_node"},
+                                        "network_broadcast_api debug_node"),
+                     "API which methods write to the database, a batch with a request to it runs one request after another");
+            }
+
             void plugin::plugin_initialize(const boost::program_options::variables_map &options) {
                 ilog("json_rpc plugin: plugin_initialize() begin");
                 pimpl = std::make_unique<impl>();
                 pimpl->initialize();
+
+                for (const auto &api : options.at("rpc-serial-api").as<std::vector<std::string>>()) {
+                    pimpl->_serial_apis.insert(api);
+                }
+                auto batch_threads = options.at("rpc-batch-threads").as<uint32_t>();
+                if (batch_threads) {
+                    ilog("json_rpc plugin: ${n} threads for batch requests", ("n", batch_threads));
+                    pimpl->start_batch_workers(batch_threads);
+                }
                 ilog("json_rpc plugin: plugin_initialize() end");
             }
 
@@ -353,6 +574,7 @@ namespace golos {
 
             void plugin::plugin_shutdown() {
                 ilog("json_rpc plugin: plugin_shutdown() begin");
+                pimpl->stop_batch_workers();
 
                 ilog("json_rpc plugin: plugin_shutdown() end");
             }
@@ -373,7 +595,7 @@ namespace golos {
                         pimpl->rpc(messages, response_handler);
                     } else {
                         msg_pack msg([response_handler](json_rpc_response &response){
-                            response_handler(fc::json::to_string(response));
+                            response_handler(to_json_string(response));
                         });
 
                         pimpl->rpc(v, msg);
@@ -384,6 +606,39 @@ namespace golos {
                     response_handler(fc::json::to_string(response));
                 }
             }
+
+            void plugin::reject(
+                const string &message, int32_t code, const string &error, response_handler_type response_handler
+            ) {
+                auto make_response = [&](const fc::variant &request) {
+                    json_rpc_response response;
+                    response.error = json_rpc_error(code, error);
+                    if (request.is_object() && request.get_object().contains("id")) {
+                        const auto &id = request.get_object()["id"];
+                        if (id.is_int64() || id.is_uint64() || id.is_string()) {
+                            response.id = id;
+                        }
+                    }
+                    return response;
+                };
+
+                fc::variant v;
+                try {
+                    v = fc::json::from_string(message);
+                } catch (const fc::exception &) {
+                    // the request can't be parsed, the error goes without an id
+                }
+
+                if (v.is_array() && !v.get_array().empty()) {
+                    vector<json_rpc_response> responses;
+                    for (const auto &request : v.get_array()) {
+                        responses.push_back(make_response(request));
+                    }
+                    response_handler(to_json_string(responses));
+                } else {
+                    response_handler(to_json_string(make_response(v)));
+                }
+            }
         }
     }
 } // golos::plugins::json_rpc
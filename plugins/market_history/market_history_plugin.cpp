@@ -59,7 +59,7 @@ namespace golos {
                     const auto &bucket_idx = _db.get_index<bucket_index>().indices().get<by_bucket>();
 
                     _db.create<order_history_object>([&](order_history_object &ho) {
-                        ho.time = _db.head_block_time();
+                        ho.time = _db.notification_time();
                         ho.op = op;
                     });
 
@@ -71,11 +71,11 @@ namespace golos {
                     }
 
                     for (auto bucket : _tracked_buckets) {
-                        auto cutoff = _db.head_block_time() - fc::seconds(
+                        auto cutoff = _db.notification_time() - fc::seconds(
                                 bucket * _maximum_history_per_bucket_size);
 
                         auto open = fc::time_point_sec(
-                                (_db.head_block_time().sec_since_epoch() /
+                                (_db.notification_time().sec_since_epoch() /
                                  bucket) * bucket);
                         auto seconds = bucket;
 
@@ -362,7 +362,9 @@ namespace golos {
                     _my.reset(new market_history_plugin_impl(*this));
                     golos::chain::database& db = _my->database();
 
-                    db.post_apply_operation.connect(
+                    // the handler reads only fill_order_operation and the objects of the plugin
+                    db.allow_async_indexing(name());
+                    db.connect_post_apply_operation(name(),
                             [&](const golos::chain::operation_notification &o) { _my->update_market_histories(o); });
                     golos::chain::add_plugin_index<bucket_index>(db);
                     golos::chain::add_plugin_index<order_history_index>(db);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <appbase/application.hpp>
+#include <golos/chain/block_profiler.hpp>
+#include <golos/plugins/chain/plugin.hpp>
+#include <golos/plugins/json_rpc/utility.hpp>
+#include <golos/plugins/json_rpc/plugin.hpp>
+
+namespace golos {
+namespace plugins {
+namespace profiler {
+
+using golos::plugins::json_rpc::msg_pack;
+using golos::plugins::json_rpc::void_type;
+
+DEFINE_API_ARGS ( get_block_profile,   msg_pack, golos::chain::block_profile )
+DEFINE_API_ARGS ( reset_block_profile, msg_pack, void_type )
+DEFINE_API_ARGS ( get_signal_handlers, msg_pack, std::vector<golos::chain::signal_handler_profile> )
+
+using boost::program_options::options_description;
+
+/**
+ * Enables the block profiler of the database and exposes it: times of the _apply_block() stages,
+ * operation evaluators, database signals and their handlers by plugin since the start (or the last reset).
+ */
+class plugin final : public appbase::plugin<plugin> {
+public:
+    APPBASE_PLUGIN_REQUIRES(
+        (chain::plugin)
+        (json_rpc::plugin)
+    )
+
+    constexpr const static char *plugin_name = "profiler";
+
+    static const std::string &name() {
+        static std::string name = plugin_name;
+        return name;
+    }
+
+    plugin();
+
+    ~plugin();
+
+    void set_program_options(
+        boost::program_options::options_description &cli,
+        boost::program_options::options_description &cfg) override;
+
+    void plugin_initialize(const boost::program_options::variables_map &options) override;
+
+    void plugin_startup() override;
+
+    void plugin_shutdown() override;
+
+    DECLARE_API (
+        (get_block_profile)
+        (reset_block_profile)
+        (get_signal_handlers)
+    )
+
+private:
+    struct plugin_impl;
+
+    std::unique_ptr<plugin_impl> my;
+};
+
+} } } // golos::plugins::profiler
@@ -0,0 +1,136 @@
+#include <golos/plugins/profiler/plugin.hpp>
+#include <golos/chain/database.hpp>
+#include <golos/plugins/json_rpc/utility.hpp>
+#include <golos/plugins/json_rpc/plugin.hpp>
+
+#include <boost/asio/deadline_timer.hpp>
+
+namespace golos {
+namespace plugins {
+namespace profiler {
+
+struct plugin::plugin_impl {
+public:
+    plugin_impl()
+        : db_(appbase::app().get_plugin<plugins::chain::plugin>().db()),
+          log_timer_(appbase::app().get_io_service()) {
+    }
+
+    void schedule_log();
+
+    void log_profile();
+
+    void stop_log() {
+        log_timer_.cancel();
+    }
+
+    // HELPING METHODS
+    golos::chain::database &database() {
+        return db_;
+    }
+
+    uint32_t log_interval = 0;
+
+private:
+    golos::chain::database &db_;
+    boost::asio::deadline_timer log_timer_;
+};
+
+void plugin::plugin_impl::schedule_log() {
+    log_timer_.expires_from_now(boost::posix_time::seconds(log_interval));
+    log_timer_.async_wait([this](const boost::system::error_code &ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+            log_profile();
+            schedule_log();
+        }
+    });
+}
+
+void plugin::plugin_impl::log_profile() {
+    auto profile = database().profiler().get_profile();
+    if (profile.fork_switches.count) {
+        ilog("Fork switches: ${c}, ${t} us total, ${m} us max, max depth ${d}",
+             ("c", profile.fork_switches.count)("t", profile.fork_switches.total_time)
+             ("m", profile.fork_switches.max_time)("d", profile.max_fork_switch_depth));
+    }
+    if (profile.blocks.count == 0) {
+        return;
+    }
+
+    ilog("Block profile for ${n} blocks, ${t} us/block",
+         ("n", profile.blocks.count)("t", profile.blocks.total_time / profile.blocks.count));
+    for (const auto &stage : profile.stages) {
+        ilog("   stage ${s}: ${c} calls, ${t} us total, ${m} us max",
+             ("s", stage.first)("c", stage.second.count)("t", stage.second.total_time)("m", stage.second.max_time));
+    }
+    for (const auto &op : profile.operations) {
+        ilog("   operation ${o}: ${c} calls, ${t} us total, ${m} us max",
+             ("o", op.first)("c", op.second.count)("t", op.second.total_time)("m", op.second.max_time));
+    }
+    for (const auto &signal : profile.signals) {
+        ilog("   signal ${s}: ${c} calls, ${t} us total, ${m} us max",
+             ("s", signal.first)("c", signal.second.count)("t", signal.second.total_time)("m", signal.second.max_time));
+    }
+    for (const auto &handler : database().profiler().get_signal_handlers()) {
+        if (handler.count) {
+            ilog("   ${s} handler of ${p}: ${c} calls, ${t} us total, ${m} us max, ${n} slow calls",
+                 ("s", handler.signal)("p", handler.plugin)("c", handler.count)("t", handler.total_time)
+                 ("m", handler.max_time)("n", handler.slow_count));
+        }
+    }
+}
+
+DEFINE_API ( plugin, get_block_profile ) {
+    return my->database().profiler().get_profile();
+}
+
+DEFINE_API ( plugin, get_signal_handlers ) {
+    return my->database().profiler().get_signal_handlers();
+}
+
+DEFINE_API ( plugin, reset_block_profile ) {
+    my->database().profiler().reset();
+    return void_type();
+}
+
+plugin::plugin() {
+}
+
+plugin::~plugin() {
+}
+
+void plugin::set_program_options(
+    boost::program_options::options_description &cli,
+    boost::program_options::options_description &cfg
+) {
+    cfg.add_options()
+        (
+            "profiler-log-interval", boost::program_options::value<uint32_t>()->default_value(600),
+            "Interval in seconds to write the block profile to the log (0 - don't write it)"
+        ) (
+            "profiler-slow-handler-threshold", boost::program_options::value<uint32_t>()->default_value(50),
+            "Warn when a plugin handler of a database signal takes longer than the threshold in milliseconds (0 - don't warn)"
+        );
+}
+
+void plugin::plugin_initialize(const boost::program_options::variables_map &options) {
+    my.reset(new plugin_impl);
+    my->log_interval = options.at("profiler-log-interval").as<uint32_t>();
+    my->database().profiler().set_slow_handler_threshold(
+        fc::milliseconds(options.at("profiler-slow-handler-threshold").as<uint32_t>()));
+    my->database().profiler().enable(true);
+    JSON_RPC_REGISTER_API ( name() ) ;
+}
+
+void plugin::plugin_startup() {
+    if (my->log_interval) {
+        my->schedule_log();
+    }
+}
+
+void plugin::plugin_shutdown() {
+    my->stop_log();
+    my->database().profiler().enable(false);
+}
+
+} } } // golos::plugin::profiler
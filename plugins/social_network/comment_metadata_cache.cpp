@@ -0,0 +1,142 @@
+#include <golos/plugins/social_network/comment_metadata_cache.hpp>
+#include <golos/plugins/social_network/tag/tags_object.hpp>
+#include <golos/plugins/social_network/languages/language_object.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <mutex>
+
+namespace golos {
+    namespace plugins {
+        namespace social_network {
+
+            namespace detail {
+                using namespace boost::multi_index;
+
+                struct comment_metadata_entry {
+                    int64_t id = 0;
+                    /// the entry is valid while the comment isn't edited
+                    time_point_sec last_update;
+                    std::shared_ptr<const parsed_comment_metadata> metadata;
+                };
+
+                struct by_comment;
+
+                typedef multi_index_container<
+                    comment_metadata_entry,
+                    indexed_by<
+                        sequenced<>,
+                        hashed_unique<tag<by_comment>,
+                            member<comment_metadata_entry, int64_t, &comment_metadata_entry::id>>>
+                > comment_metadata_index;
+
+                class comment_metadata_cache_impl {
+                public:
+                    std::mutex mutex;
+                    comment_metadata_index entries;
+                    uint32_t max_size = comment_metadata_cache::default_max_size;
+
+                    void shrink(uint32_t size) {
+                        while (entries.size() > size) {
+                            entries.pop_back();
+                        }
+                    }
+                };
+            }
+
+            std::shared_ptr<const parsed_comment_metadata> parse_comment_metadata(const std::string &json_metadata) {
+                auto result = std::make_shared<parsed_comment_metadata>();
+                if (json_metadata.empty()) {
+                    return result;
+                }
+
+                fc::variant meta;
+                try {
+                    meta = fc::json::from_string(json_metadata);
+                } catch (...) {
+                    // Do nothing on malformed json_metadata
+                    return result;
+                }
+
+                // fields are converted separately, a malformed one doesn't hide the other
+                try {
+                    result->tags = std::move(meta.as<tags::comment_metadata>().tags);
+                } catch (...) {
+                }
+                try {
+                    result->language = std::move(meta.as<languages::comment_metadata>().language);
+                } catch (...) {
+                }
+                return result;
+            }
+
+            comment_metadata_cache::comment_metadata_cache(uint32_t max_size)
+                    : my(new detail::comment_metadata_cache_impl()) {
+                my->max_size = max_size;
+            }
+
+            comment_metadata_cache::~comment_metadata_cache() {
+            }
+
+            void comment_metadata_cache::set_max_size(uint32_t max_size) {
+                std::lock_guard<std::mutex> lock(my->mutex);
+                my->max_size = max_size;
+                my->shrink(max_size);
+            }
+
+            std::shared_ptr<const parsed_comment_metadata> comment_metadata_cache::get(const comment_api_object &c) {
+                int64_t id = c.id._id;
+                {
+                    std::lock_guard<std::mutex> lock(my->mutex);
+                    auto &idx = my->entries.get<detail::by_comment>();
+                    auto itr = idx.find(id);
+                    if (itr != idx.end()) {
+                        if (itr->last_update == c.last_update) {
+                            my->entries.relocate(my->entries.begin(), my->entries.project<0>(itr));
+                            return itr->metadata;
+                        }
+                        idx.erase(itr);
+                    }
+                }
+
+                // parse outside of the lock, concurrent queries don't wait for each other
+                auto metadata = parse_comment_metadata(c.json_metadata);
+
+                std::lock_guard<std::mutex> lock(my->mutex);
+                if (my->max_size == 0) {
+                    return metadata;
+                }
+
+                auto &idx = my->entries.get<detail::by_comment>();
+                auto itr = idx.find(id);
+                if (itr != idx.end()) {
+                    // another query has parsed the comment meanwhile
+                    idx.modify(itr, [&](detail::comment_metadata_entry &e) {
+                        e.last_update = c.last_update;
+                        e.metadata = metadata;
+                    });
+                    return metadata;
+                }
+
+                detail::comment_metadata_entry entry;
+                entry.id = id;
+                entry.last_update = c.last_update;
+                entry.metadata = metadata;
+                my->entries.push_front(std::move(entry));
+                my->shrink(my->max_size);
+                return metadata;
+            }
+
+            void comment_metadata_cache::erase(comment_object::id_type id) {
+                std::lock_guard<std::mutex> lock(my->mutex);
+                my->entries.get<detail::by_comment>().erase(id._id);
+            }
+
+        }
+    }
+} // golos::plugins::social_network
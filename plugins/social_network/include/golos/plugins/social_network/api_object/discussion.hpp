@@ -2,6 +2,7 @@
 
 #include <golos/plugins/social_network/api_object/vote_state.hpp>
 #include <golos/plugins/social_network/api_object/comment_api_object.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
 
 
 namespace golos {
@@ -33,3 +34,4 @@ namespace golos {
     }
 }
 FC_REFLECT_DERIVED((golos::plugins::social_network::discussion), ((golos::plugins::social_network::comment_api_object)), (url)(root_title)(pending_payout_value)(total_pending_payout_value)(active_votes)(replies)(author_reputation)(promoted)(body_length)(reblogged_by)(first_reblogged_by)(first_reblogged_on))
+JSON_STREAM_REFLECTED(golos::plugins::social_network::discussion)
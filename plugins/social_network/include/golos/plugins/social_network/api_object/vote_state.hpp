@@ -1,5 +1,6 @@
 #pragma once
 #include <fc/reflect/reflect.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
 namespace golos {
     namespace plugins {
         namespace social_network {
@@ -18,4 +19,6 @@ namespace golos {
 }
 
 
-FC_REFLECT((golos::plugins::social_network::vote_state), (voter)(weight)(rshares)(percent)(reputation)(time));
\ No newline at end of file
+FC_REFLECT((golos::plugins::social_network::vote_state), (voter)(weight)(rshares)(percent)(reputation)(time));
+
+JSON_STREAM_REFLECTED(golos::plugins::social_network::vote_state)
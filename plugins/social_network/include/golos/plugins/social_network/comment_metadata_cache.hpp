@@ -0,0 +1,67 @@
+#pragma once
+
+#include <golos/plugins/social_network/api_object/comment_api_object.hpp>
+#include <golos/plugins/social_network/api_object/discussion_query.hpp>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace golos {
+    namespace plugins {
+        namespace social_network {
+
+            namespace detail { class comment_metadata_cache_impl; }
+
+            /**
+             * Fields of the comment json_metadata used by the discussion filters
+             */
+            struct parsed_comment_metadata {
+                std::set<std::string> tags;
+                std::string language;
+            };
+
+            /**
+             * Bounded LRU cache of the parsed json_metadata of comments. Discussion queries filter
+             * the same top comments again and again, with the cache their json_metadata is parsed once
+             * and then only when the comment is edited.
+             */
+            class comment_metadata_cache final {
+            public:
+                explicit comment_metadata_cache(uint32_t max_size = default_max_size);
+
+                ~comment_metadata_cache();
+
+                void set_max_size(uint32_t max_size);
+
+                std::shared_ptr<const parsed_comment_metadata> get(const comment_api_object &c);
+
+                /**
+                 * Forget the comment, called when it is changed or deleted
+                 */
+                void erase(comment_object::id_type id);
+
+                static const uint32_t default_max_size = 100000;
+
+            private:
+                std::unique_ptr<detail::comment_metadata_cache_impl> my;
+            };
+
+            /**
+             * Malformed json_metadata or its fields are treated as empty
+             */
+            std::shared_ptr<const parsed_comment_metadata> parse_comment_metadata(const std::string &json_metadata);
+
+            /**
+             * Filters of the discussion queries, return true when the comment is filtered out
+             */
+            bool tags_filter(comment_metadata_cache &cache, const discussion_query &query, const comment_api_object &c,
+                             const std::function<bool(const comment_api_object &)> &condition);
+
+            bool languages_filter(comment_metadata_cache &cache, const discussion_query &query, const comment_api_object &c,
+                                  const std::function<bool(const comment_api_object &)> &condition);
+
+        }
+    }
+} // golos::plugins::social_network
@@ -1,5 +1,6 @@
 #include <boost/program_options/options_description.hpp>
 #include <golos/plugins/social_network/social_network.hpp>
+#include <golos/plugins/social_network/comment_metadata_cache.hpp>
 #include <golos/plugins/social_network/tag/tags_object.hpp>
 #include <golos/plugins/social_network/languages/language_object.hpp>
 #include <golos/chain/index.hpp>
@@ -44,26 +45,19 @@ namespace golos {
                 return discussions;
             }
 
-            bool tags_filter(const discussion_query &query, const comment_api_object &c, const std::function<bool(const comment_api_object &)> &condition) {
+            bool tags_filter(comment_metadata_cache &cache, const discussion_query &query, const comment_api_object &c, const std::function<bool(const comment_api_object &)> &condition) {
                 if (query.select_authors.size()) {
                     if (query.select_authors.find(c.author) == query.select_authors.end()) {
                         return true;
                     }
                 }
 
-                tags::comment_metadata meta;
-
-                if (!c.json_metadata.empty()) {
-                    try {
-                        meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-                    } catch (const fc::exception &e) {
-                        // Do nothing on malformed json_metadata
-                    }
-                }
-
-                for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                    if (meta.tags.find(iterator) != meta.tags.end()) {
-                        return true;
+                if (!query.filter_tags.empty()) {
+                    auto meta = cache.get(c);
+                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
+                        if (meta->tags.find(iterator) != meta->tags.end()) {
+                            return true;
+                        }
                     }
                 }
 
@@ -71,8 +65,10 @@ namespace golos {
             }
 
 
-            bool languages_filter(const discussion_query &query, const comment_api_object &c, const std::function<bool(const comment_api_object &)> &condition) {
-                std::string language = languages::get_language(c);
+            bool languages_filter(comment_metadata_cache &cache, const discussion_query &query, const comment_api_object &c, const std::function<bool(const comment_api_object &)> &condition) {
+                // the metadata isn't kept by a cache of size 0 and can be evicted by another query
+                auto meta = cache.get(c);
+                const std::string &language = meta->language;
 
                 if (query.filter_languages.size()) {
                     if (language.empty()) {
@@ -95,6 +91,13 @@ namespace golos {
                 void on_operation(const operation_notification &note){
                     try {
                         /// plugins shouldn't ever throw
+                        if (note.op.which() == operation::tag<golos::protocol::comment_operation>::value) {
+                            const auto &op = note.op.get<golos::protocol::comment_operation>();
+                            const auto *comment = database().find_comment(op.author, op.permlink);
+                            if (comment != nullptr) {
+                                metadata_cache.erase(comment->id);
+                            }
+                        }
                         note.op.visit(languages::operation_visitor(database(), cache_languages));
                         note.op.visit(tags::operation_visitor(database()));
                     } catch (const fc::exception &e) {
@@ -251,6 +254,8 @@ namespace golos {
                 get_languages_r get_languages() ;
 
                 std::set<std::string> cache_languages;
+
+                mutable comment_metadata_cache metadata_cache;
             private:
                 golos::chain::database& database_;
             };
@@ -290,13 +295,20 @@ namespace golos {
             }
 
             void social_network_t::set_program_options(boost::program_options::options_description &, boost::program_options::options_description &config_file_options) {
-
+                config_file_options.add_options()
+                    ("comment-metadata-cache-size",
+                        boost::program_options::value<uint32_t>()->default_value(comment_metadata_cache::default_max_size),
+                        "Number of comments which parsed json_metadata is cached for filters of discussion queries "
+                        "(0 - parse it for every candidate)");
             }
 
             void social_network_t::plugin_initialize(const boost::program_options::variables_map &options) {
                 pimpl.reset(new impl());
                 auto &db = pimpl->database();
-                pimpl->database().post_apply_operation.connect([&](const operation_notification &note) {
+                if (options.count("comment-metadata-cache-size")) {
+                    pimpl->metadata_cache.set_max_size(options.at("comment-metadata-cache-size").as<uint32_t>());
+                }
+                pimpl->database().connect_post_apply_operation(name(), [&](const operation_notification &note) {
                     pimpl->on_operation(note);
                 });
                 add_plugin_index<tags::tag_index>(db);
@@ -934,7 +946,7 @@ namespace golos {
                             tags::by_comment>(
                             query.select_tags,
                             query, parent,
-                            std::bind(tags_filter, query, std::placeholders::_1, [&](const comment_api_object &c) -> bool {
+                            std::bind(tags_filter, std::ref(pimpl->metadata_cache), query, std::placeholders::_1, [&](const comment_api_object &c) -> bool {
                                 return c.net_rshares <= 0;
                             }),
                             [&](const comment_api_object &c) -> bool {
@@ -960,7 +972,7 @@ namespace golos {
                             query,
                             parent,
                             std::bind(
-                                    languages_filter,
+                                    languages_filter, std::ref(pimpl->metadata_cache),
                                     query,
                                     std::placeholders::_1,
                                     [&](const comment_api_object &c) -> bool {
@@ -995,7 +1007,7 @@ namespace golos {
                                         query,
                                         parent,
                                         std::bind(
-                                                tags_filter,
+                                                tags_filter, std::ref(metadata_cache),
                                                 query,
                                                 std::placeholders::_1,
                                                 [&](const comment_api_object &c) -> bool {
@@ -1015,7 +1027,7 @@ namespace golos {
                         languages::by_parent_promoted> map_result_language =
                         select < languages::language_object, languages::language_index, languages::by_parent_promoted,
                                 languages::by_comment >
-                                (query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                                (query.select_tags, query, parent, std::bind(languages_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                                                              [&](const comment_api_object &c) -> bool {
                                                                                  return c.children_rshares2 <= 0;
                                                                              }), [&](const comment_api_object &c) -> bool {
@@ -1077,7 +1089,7 @@ namespace golos {
                 std::multimap<tags::tag_object, discussion, tags::by_parent_created> map_result = select <
                         tags::tag_object, tags::tag_index, tags::by_parent_created, tags::by_comment >
                         (query.select_tags, query, parent, std::bind(
-                                tags_filter, query,
+                                tags_filter, std::ref(metadata_cache), query,
                                 std::placeholders::_1,
                                 [&](const comment_api_object &c) -> bool {
                                     return false;
@@ -1092,7 +1104,7 @@ namespace golos {
                         languages::by_parent_created> map_result_language =
                         select < languages::language_object, languages::language_index, languages::by_parent_created,
                                 languages::by_comment >
-                                (query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                                (query.select_tags, query, parent, std::bind(languages_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                                                              [&](const comment_api_object &c) -> bool {
                                                                                  return false;
                                                                              }), [&](const comment_api_object &c) -> bool {
@@ -1124,7 +1136,7 @@ namespace golos {
                 std::multimap<tags::tag_object, discussion, tags::by_parent_active> map_result = select <
                         tags::tag_object, tags::tag_index, tags::by_parent_active, tags::by_comment >
                         (query.select_tags, query, parent, std::bind(
-                                tags_filter, query,
+                                tags_filter, std::ref(metadata_cache), query,
                                 std::placeholders::_1,
                                 [&](const comment_api_object &c) -> bool {
                                     return false;
@@ -1138,7 +1150,7 @@ namespace golos {
                 std::multimap<languages::language_object, discussion, languages::by_parent_active> map_result_language =
                         select < languages::language_object, languages::language_index, languages::by_parent_active,
                                 languages::by_comment >
-                                (query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                                (query.select_tags, query, parent, std::bind(languages_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                                                              [&](const comment_api_object &c) -> bool {
                                                                                  return false;
                                                                              }), [&](const comment_api_object &c) -> bool {
@@ -1169,7 +1181,7 @@ namespace golos {
                 std::multimap<tags::tag_object, discussion, tags::by_cashout> map_result = select <
                         tags::tag_object, tags::tag_index, tags::by_cashout, tags::by_comment >
                         (query.select_tags, query, parent, std::bind(
-                                tags_filter, query, std::placeholders::_1,
+                                tags_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                 [&](const comment_api_object &c) -> bool {
                                     return c.children_rshares2 <= 0;
                                 }), [&](
@@ -1183,7 +1195,7 @@ namespace golos {
                         select <
                                 languages::language_object, languages::language_index, languages::by_cashout, languages::by_comment >
                                 (query.select_tags, query, parent, std::bind(
-                                        languages_filter,
+                                        languages_filter, std::ref(metadata_cache),
                                         query,
                                         std::placeholders::_1,
                                         [&](const comment_api_object &c) -> bool {
@@ -1219,7 +1231,7 @@ namespace golos {
 
                     std::multimap<tags::tag_object, discussion, tags::by_net_rshares> map_result = pimpl->select<
                             tags::tag_object, tags::tag_index, tags::by_net_rshares, tags::by_comment>(
-                            query.select_tags, query, parent, std::bind(tags_filter, query, std::placeholders::_1,
+                            query.select_tags, query, parent, std::bind(tags_filter, std::ref(pimpl->metadata_cache), query, std::placeholders::_1,
                                                                         [&](const comment_api_object &c) -> bool {
                                                                             return c.children_rshares2 <= 0;
                                                                         }), [&](const comment_api_object &c) -> bool {
@@ -1231,7 +1243,7 @@ namespace golos {
                     std::multimap<languages::language_object, discussion,
                             languages::by_net_rshares> map_result_language = pimpl->select<languages::language_object,
                             languages::language_index, languages::by_net_rshares, languages::by_comment>(
-                            query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                            query.select_tags, query, parent, std::bind(languages_filter, std::ref(pimpl->metadata_cache), query, std::placeholders::_1,
                                                                         [&](const comment_api_object &c) -> bool {
                                                                             return c.children_rshares2 <= 0;
                                                                         }), [&](const comment_api_object &c) -> bool {
@@ -1254,7 +1266,7 @@ namespace golos {
                 std::multimap<tags::tag_object, discussion, tags::by_parent_net_votes> map_result = select <
                         tags::tag_object, tags::tag_index, tags::by_parent_net_votes, tags::by_comment >
                         (query.select_tags, query, parent, std::bind(
-                                tags_filter, query,
+                                tags_filter, std::ref(metadata_cache), query,
                                 std::placeholders::_1,
                                 [&](const comment_api_object &c) -> bool {
                                     return false;
@@ -1270,7 +1282,7 @@ namespace golos {
                         languages::by_parent_net_votes> map_result_language =
                         select < languages::language_object, languages::language_index, languages::by_parent_net_votes,
                                 languages::by_comment >
-                                (query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                                (query.select_tags, query, parent, std::bind(languages_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                                                              [&](const comment_api_object &c) -> bool {
                                                                                  return false;
                                                                              }), [&](const comment_api_object &c) -> bool {
@@ -1304,7 +1316,7 @@ namespace golos {
 
                         select < tags::tag_object, tags::tag_index, tags::by_parent_children, tags::by_comment >
                                 (query.select_tags, query, parent, std::bind(
-                                        tags_filter, query,
+                                        tags_filter, std::ref(metadata_cache), query,
                                         std::placeholders::_1,
                                         [&](const comment_api_object &c) -> bool {
                                             return false;
@@ -1320,7 +1332,7 @@ namespace golos {
                         languages::by_parent_children> map_result_language =
                         select < languages::language_object, languages::language_index, languages::by_parent_children,
                                 languages::by_comment >
-                                (query.select_tags, query, parent, std::bind(languages_filter, query, std::placeholders::_1,
+                                (query.select_tags, query, parent, std::bind(languages_filter, std::ref(metadata_cache), query, std::placeholders::_1,
                                                                              [&](const comment_api_object &c) -> bool {
                                                                                  return false;
                                                                              }), [&](const comment_api_object &c) -> bool {
@@ -1352,7 +1364,7 @@ namespace golos {
                 std::multimap<tags::tag_object, discussion, tags::by_parent_hot> map_result = select <
                         tags::tag_object, tags::tag_index, tags::by_parent_hot, tags::by_comment >
                         (query.select_tags, query, parent, std::bind(
-                                tags_filter, query,
+                                tags_filter, std::ref(metadata_cache), query,
                                 std::placeholders::_1,
                                 [&](const comment_api_object &c) -> bool {
                                     return c.net_rshares <= 0;
@@ -1367,7 +1379,7 @@ namespace golos {
                         select <
                                 languages::language_object, languages::language_index, languages::by_parent_hot, languages::by_comment >
                                 (query.select_tags, query, parent, std::bind(
-                                        languages_filter,
+                                        languages_filter, std::ref(metadata_cache),
                                         query,
                                         std::placeholders::_1,
                                         [&](const comment_api_object &c) -> bool {
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace golos {
+    namespace plugins {
+        namespace webserver {
+
+            /**
+              * Executes API requests on a small number of worker threads.
+              *
+              * Requests of one connection are queued in order and executed one at a time,
+              * connections with queued requests take turns on the workers. Both the queue of
+              * a connection and the total number of queued requests are bounded: a request
+              * which doesn't fit is rejected, and the client is told the server is overloaded,
+              * instead of waiting in an ever-growing queue.
+              */
+            class request_executor final {
+            public:
+                using task_type = std::function<void()>;
+
+                request_executor(uint32_t threads, uint32_t max_queue_size, uint32_t max_connection_queue_size);
+
+                ~request_executor();
+
+                /**
+                  * @param connection identifies the connection the request came from
+                  * @return false if the request is rejected
+                  */
+                bool post(const void *connection, task_type task);
+
+                void stop();
+
+            private:
+                struct connection_queue {
+                    std::deque<task_type> tasks;
+                    /// the connection is in the ready queue or its request is being executed
+                    bool scheduled = false;
+                };
+
+                void run();
+
+                const uint32_t _max_queue_size;
+                const uint32_t _max_connection_queue_size;
+
+                std::mutex _mutex;
+                std::condition_variable _cv;
+                bool _stopped = false;
+                uint32_t _queue_size = 0;
+                uint64_t _rejected = 0;
+                std::unordered_map<const void *, connection_queue> _connections;
+                std::deque<const void *> _ready;
+
+                std::vector<std::thread> _threads;
+            };
+
+        }
+    }
+} // golos::plugins::webserver
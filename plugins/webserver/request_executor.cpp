@@ -0,0 +1,110 @@
+#include <golos/plugins/webserver/request_executor.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+namespace golos {
+    namespace plugins {
+        namespace webserver {
+
+            request_executor::request_executor(
+                uint32_t threads, uint32_t max_queue_size, uint32_t max_connection_queue_size
+            ) : _max_queue_size(max_queue_size),
+                _max_connection_queue_size(max_connection_queue_size) {
+                FC_ASSERT(threads > 0, "Executor needs at least one thread");
+                for (uint32_t i = 0; i < threads; ++i) {
+                    _threads.emplace_back([this]() { run(); });
+                }
+            }
+
+            request_executor::~request_executor() {
+                stop();
+            }
+
+            bool request_executor::post(const void *connection, task_type task) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_stopped) {
+                    return false;
+                }
+
+                auto itr = _connections.find(connection);
+                if (_queue_size >= _max_queue_size ||
+                    (itr != _connections.end() && itr->second.tasks.size() >= _max_connection_queue_size)
+                ) {
+                    if (_rejected++ % 1000 == 0) {
+                        wlog("Webserver is overloaded, ${n} requests rejected so far", ("n", _rejected));
+                    }
+                    return false;
+                }
+
+                auto &queue = _connections[connection];
+                queue.tasks.push_back(std::move(task));
+                ++_queue_size;
+                if (!queue.scheduled) {
+                    queue.scheduled = true;
+                    _ready.push_back(connection);
+                    _cv.notify_one();
+                }
+                return true;
+            }
+
+            void request_executor::stop() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stopped = true;
+                }
+                _cv.notify_all();
+
+                for (auto &thread : _threads) {
+                    if (thread.joinable()) {
+                        thread.join();
+                    }
+                }
+                _threads.clear();
+            }
+
+            void request_executor::run() {
+                while (true) {
+                    const void *connection;
+                    task_type task;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _cv.wait(lock, [&]() { return _stopped || !_ready.empty(); });
+                        if (_stopped) {
+                            return;
+                        }
+
+                        connection = _ready.front();
+                        _ready.pop_front();
+                        auto &queue = _connections[connection];
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                        --_queue_size;
+                    }
+
+                    try {
+                        task();
+                    } catch (const fc::exception &e) {
+                        elog("Unhandled exception in API request: ${e}", ("e", e.to_detail_string()));
+                    } catch (const std::exception &e) {
+                        elog("Unhandled exception in API request: ${e}", ("e", e.what()));
+                    } catch (...) {
+                        elog("Unhandled exception in API request");
+                    }
+
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto itr = _connections.find(connection);
+                    if (itr->second.tasks.empty()) {
+                        // the next request of the connection will schedule it again
+                        _connections.erase(itr);
+                    } else {
+                        // to the back of the ready queue, so other connections aren't starved
+                        _ready.push_back(connection);
+                        _cv.notify_one();
+                    }
+                }
+            }
+
+        }
+    }
+} // golos::plugins::webserver
@@ -1,4 +1,5 @@
 #include <golos/plugins/webserver/webserver_plugin.hpp>
+#include <golos/plugins/webserver/request_executor.hpp>
 
 #include <golos/plugins/chain/plugin.hpp>
 
@@ -40,6 +41,9 @@ namespace golos {
 
             typedef uint32_t thread_pool_size_t;
 
+            /// error of the requests rejected by the executor, clients can look for "overloaded" in it
+            const char *overloaded_message = "Server is overloaded, try again later";
+
             struct asio_with_stub_log : public websocketpp::config::asio {
                 typedef asio_with_stub_log type;
                 typedef asio base;
@@ -93,6 +97,20 @@ namespace golos {
 
                 void handle_http_message(websocket_server_type *, connection_hdl);
 
+                /**
+                  * Run the request on the executor or on the thread pool
+                  *
+                  * @return false if the executor rejected the request
+                  */
+                template<typename Task>
+                bool post_request(const void *connection, Task &&task) {
+                    if (executor) {
+                        return executor->post(connection, std::forward<Task>(task));
+                    }
+                    thread_pool_ios.post(std::forward<Task>(task));
+                    return true;
+                }
+
                 shared_ptr<std::thread> http_thread;
                 asio::io_service http_ios;
                 optional<tcp::endpoint> http_endpoint;
@@ -104,6 +122,7 @@ namespace golos {
                 websocket_server_type ws_server;
                 asio::io_service thread_pool_ios;
                 asio::io_service::work thread_pool_work;
+                std::unique_ptr<request_executor> executor;
 
                 plugins::json_rpc::plugin *api;
                 boost::signals2::connection chain_sync_con;
@@ -173,6 +192,9 @@ namespace golos {
                     http_server.stop_listening();
                 }
 
+                if (executor) {
+                    executor->stop();
+                }
                 thread_pool_ios.stop();
                 thread_pool.join_all();
 
@@ -195,7 +217,7 @@ namespace golos {
                 websocket_server_type::message_ptr msg
             ) {
                 auto con = server->get_con_from_hdl(hdl);
-                thread_pool_ios.post([con, msg, this]() {
+                bool accepted = post_request(con.get(), [con, msg, this]() {
                     try {
                         if (msg->get_opcode() == websocketpp::frame::opcode::text) {
                             api->call(msg->get_payload(), [con](const std::string &data){
@@ -211,13 +233,23 @@ namespace golos {
                         con->send("error calling API " + e.to_string());
                     }
                 });
+
+                if (!accepted) {
+                    try {
+                        api->reject(msg->get_payload(), JSON_RPC_SERVER_ERROR, overloaded_message, [con](const std::string &data) {
+                            con->send(data);
+                        });
+                    } catch (...) {
+                        // the connection is closed
+                    }
+                }
             }
 
             void webserver_plugin::webserver_plugin_impl::handle_http_message(websocket_server_type *server, connection_hdl hdl) {
                 auto con = server->get_con_from_hdl(hdl);
                 con->defer_http_response();
 
-                thread_pool_ios.post([con, this]() {
+                bool accepted = post_request(con.get(), [con, this]() {
                     auto body = con->get_request_body();
 
                     try {
@@ -243,6 +275,14 @@ namespace golos {
                         }
                     }
                 });
+
+                if (!accepted) {
+                    api->reject(con->get_request_body(), JSON_RPC_SERVER_ERROR, overloaded_message, [con](const std::string &data) {
+                        con->set_body(data);
+                        con->set_status(websocketpp::http::status_code::service_unavailable);
+                        con->send_http_response();
+                    });
+                }
             }
 
             webserver_plugin::webserver_plugin() {
@@ -259,14 +299,39 @@ namespace golos {
                         "rpc-endpoint", boost::program_options::value<string>(),
                         "Local http and websocket endpoint for webserver requests. Deprectaed in favor of webserver-http-endpoint and webserver-ws-endpoint")(
                         "webserver-thread-pool-size", boost::program_options::value<thread_pool_size_t>()->default_value(256),
-                        "Number of threads used to handle queries. Default: 256.");
+                        "Number of threads used to handle queries. Default: 256.")(
+                        "webserver-executor", boost::program_options::value<bool>()->default_value(false),
+                        "Handle queries on a few executor threads with bounded queues instead of the thread pool, "
+                        "queries which don't fit into the queues are rejected")(
+                        "webserver-executor-threads", boost::program_options::value<thread_pool_size_t>()->default_value(0),
+                        "Number of executor threads (0 - number of CPU cores)")(
+                        "webserver-executor-queue-size", boost::program_options::value<uint32_t>()->default_value(4096),
+                        "Max number of queries waiting for the executor")(
+                        "webserver-connection-queue-size", boost::program_options::value<uint32_t>()->default_value(32),
+                        "Max number of queries of one connection waiting for the executor, "
+                        "queries of a connection are handled one at a time");
             }
 
             void webserver_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
-                auto thread_pool_size = options.at("webserver-thread-pool-size").as<thread_pool_size_t>();
-                FC_ASSERT(thread_pool_size > 0, "webserver-thread-pool-size must be greater than 0");
-                ilog("configured with ${tps} thread pool size", ("tps", thread_pool_size));
-                my.reset(new webserver_plugin_impl(thread_pool_size));
+                if (options.at("webserver-executor").as<bool>()) {
+                    auto threads = options.at("webserver-executor-threads").as<thread_pool_size_t>();
+                    if (threads == 0) {
+                        threads = std::max(std::thread::hardware_concurrency(), 1u);
+                    }
+                    auto queue_size = options.at("webserver-executor-queue-size").as<uint32_t>();
+                    auto connection_queue_size = options.at("webserver-connection-queue-size").as<uint32_t>();
+                    FC_ASSERT(queue_size > 0, "webserver-executor-queue-size must be greater than 0");
+                    FC_ASSERT(connection_queue_size > 0, "webserver-connection-queue-size must be greater than 0");
+                    ilog("configured with ${t} executor threads, ${q} queue size, ${c} connection queue size",
+                         ("t", threads)("q", queue_size)("c", connection_queue_size));
+                    my.reset(new webserver_plugin_impl(0));
+                    my->executor.reset(new request_executor(threads, queue_size, connection_queue_size));
+                } else {
+                    auto thread_pool_size = options.at("webserver-thread-pool-size").as<thread_pool_size_t>();
+                    FC_ASSERT(thread_pool_size > 0, "webserver-thread-pool-size must be greater than 0");
+                    ilog("configured with ${tps} thread pool size", ("tps", thread_pool_size));
+                    my.reset(new webserver_plugin_impl(thread_pool_size));
+                }
 
                 if (options.count("webserver-http-endpoint")) {
                     auto http_endpoint = options.at("webserver-http-endpoint").as<string>();
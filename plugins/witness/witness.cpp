@@ -246,7 +246,7 @@ namespace golos {
                         elog("No witnesses configured! Please add witness names and private keys to configuration.");
                     if (!pimpl->_miners.empty()) {
                         ilog("Starting mining...");
-                        d.applied_block.connect([this](const protocol::signed_block &b) { pimpl->on_applied_block(b); });
+                        d.connect_applied_block(name(), [this](const protocol::signed_block &b) { pimpl->on_applied_block(b); });
                     } else {
                         elog("No miners configured! Please add miner names and private keys to configuration.");
                     }
@@ -0,0 +1,163 @@
+#include <golos/chain/block_log.hpp>
+#include <golos/chain/compressed_block_log.hpp>
+#include <golos/chain/database.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+#include <random>
+
+/**
+ * Compares the plain block log with the compressed chunked block log:
+ *  - disk use of both formats;
+ *  - replay of the first blocks into a new state, reading them from each format;
+ *  - sequential read of all blocks, that is the way replay reads the log;
+ *  - random reads by block number, that is the way API and p2p read the log.
+ */
+
+namespace {
+    double seconds_since(const fc::time_point &start) {
+        return std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001);
+    }
+
+    void report(const std::string &name, uint64_t count, double seconds) {
+        std::cout << "   " << name << ": " << count << " blocks in " << seconds << " sec, "
+                  << uint64_t(count / seconds) << " blocks/s\n";
+    }
+
+    /**
+     * Apply blocks to a new state with the checks skipped by reindex, read_block gives the block by number
+     */
+    template<typename ReadBlock>
+    double replay(uint32_t block_count, uint64_t shared_file_size, ReadBlock &&read_block) {
+        using golos::chain::database;
+
+        fc::temp_directory data_dir(fc::temp_directory_path());
+        database db;
+        db._log_hardforks = false;
+        db.open(data_dir.path(), data_dir.path(), STEEMIT_INIT_SUPPLY, shared_file_size, chainbase::database::read_write);
+
+        const uint32_t skip =
+            database::skip_witness_signature |
+            database::skip_transaction_signatures |
+            database::skip_transaction_dupe_check |
+            database::skip_fork_db |
+            database::skip_tapos_check |
+            database::skip_merkle_check |
+            database::skip_witness_schedule_check |
+            database::skip_authority_check |
+            database::skip_validate |
+            database::skip_validate_invariants |
+            database::skip_undo_history_check |
+            database::skip_block_log;
+
+        auto start = fc::time_point::now();
+        for (uint32_t block_num = 1; block_num <= block_count; ++block_num) {
+            auto block = read_block(block_num);
+            FC_ASSERT(block.valid(), "Block log doesn't have block ${n}", ("n", block_num));
+            db.push_block(*block, skip);
+        }
+        auto seconds = seconds_since(start);
+
+        db.close();
+        return seconds;
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 3) {
+            std::cerr << "bench_block_log <block_log> <compressed_block_log> [random_reads] [replay_blocks] [shared_file_size_mb]\n"
+                    "\n"
+                    "Both files should contain the same blocks, use convert_block_log to make the compressed one.\n"
+                    "Replay applies the first replay_blocks blocks (100000 by default, 0 to skip) to a new state\n"
+                    "in a temporary directory.\n";
+            return 1;
+        }
+
+        fc::path plain_file(argv[1]);
+        fc::path compressed_file(argv[2]);
+        uint32_t random_reads = argc > 3 ? std::stoul(argv[3]) : 100000;
+        uint32_t replay_blocks = argc > 4 ? std::stoul(argv[4]) : 100000;
+        uint64_t shared_file_size = (argc > 5 ? std::stoull(argv[5]) : 8192) * 1024 * 1024;
+
+        golos::chain::block_log plain;
+        plain.open(plain_file);
+        FC_ASSERT(plain.head(), "Block log ${file} is empty", ("file", plain_file));
+
+        golos::chain::compressed_block_log compressed;
+        compressed.open(compressed_file);
+
+        auto head_block_num = plain.head()->block_num();
+        FC_ASSERT(compressed.head_block_num() == head_block_num, "Block logs have different heads",
+                  ("plain", head_block_num)("compressed", compressed.head_block_num()));
+
+        auto plain_size = fc::file_size(plain_file) + fc::file_size(fc::path(plain_file.generic_string() + ".index"));
+        auto compressed_size = fc::file_size(compressed_file);
+
+        std::cout << "Disk use:\n"
+                  << "   plain: " << plain_size / (1024 * 1024) << "M\n"
+                  << "   compressed: " << compressed_size / (1024 * 1024) << "M ("
+                  << compressed.blocks_per_chunk() << " blocks per chunk), "
+                  << double(compressed_size * 100) / plain_size << "% of plain\n";
+
+        replay_blocks = std::min(replay_blocks, head_block_num);
+        if (replay_blocks) {
+            std::cout << "Replay:\n";
+            report("plain", replay_blocks, replay(replay_blocks, shared_file_size, [&](uint32_t block_num) {
+                return plain.read_block_by_num(block_num);
+            }));
+            report("compressed", replay_blocks, replay(replay_blocks, shared_file_size, [&](uint32_t block_num) {
+                return compressed.read_block_by_num(block_num);
+            }));
+        }
+
+        std::cout << "Sequential read:\n";
+        {
+            auto start = fc::time_point::now();
+            auto itr = plain.read_block(0);
+            while (itr.first.block_num() != head_block_num) {
+                itr = plain.read_block(itr.second);
+            }
+            report("plain", head_block_num, seconds_since(start));
+        }
+        {
+            auto start = fc::time_point::now();
+            for (uint32_t block_num = 1; block_num <= head_block_num; ++block_num) {
+                compressed.read_block_by_num(block_num);
+            }
+            report("compressed", head_block_num, seconds_since(start));
+        }
+
+        std::cout << "Random read:\n";
+        std::mt19937 generator(head_block_num);
+        std::uniform_int_distribution<uint32_t> distribution(1, head_block_num);
+        std::vector<uint32_t> block_nums(random_reads);
+        for (auto &block_num : block_nums) {
+            block_num = distribution(generator);
+        }
+        {
+            auto start = fc::time_point::now();
+            for (auto block_num : block_nums) {
+                plain.read_block_by_num(block_num);
+            }
+            report("plain", random_reads, seconds_since(start));
+        }
+        {
+            auto start = fc::time_point::now();
+            for (auto block_num : block_nums) {
+                compressed.read_block_by_num(block_num);
+            }
+            report("compressed", random_reads, seconds_since(start));
+        }
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <golos/plugins/social_network/comment_metadata_cache.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+
+/**
+ * Measures the filter of discussion queries by tags (filter_tags of discussion_query) on
+ * the same candidates again and again, as trending and feed queries of the clients do:
+ *  - parse: json_metadata of every candidate is parsed on every query, comment-metadata-cache-size = 0;
+ *  - cache: parsed metadata is taken from the cache.
+ *
+ *   bench_comment_metadata parse|cache [comments] [queries]
+ */
+
+namespace {
+    using namespace golos::plugins::social_network;
+
+    std::vector<comment_api_object> make_comments(uint32_t count) {
+        std::vector<comment_api_object> comments(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto &c = comments[i];
+            c.id = comment_object::id_type(i);
+            c.author = "author" + std::to_string(i % 100);
+            c.category = "golos";
+            c.last_update = fc::time_point_sec(1476788400 + i);
+            c.json_metadata =
+                R"({"tags":["golos","ru--blokcheijn","tag)" + std::to_string(i % 50) + R"(","ru--zhiznx"],)"
+                R"("image":["https://images.golos.io/DQmTx/)" + std::to_string(i) + R"(.jpg"],)"
+                R"("links":["https://golos.io/@author/post"],"app":"golos.io/0.1","format":"markdown"})";
+        }
+        return comments;
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 2) {
+            std::cerr << "bench_comment_metadata parse|cache [comments] [queries]\n"
+                    "\n"
+                    "Defaults are 1000 candidate comments filtered by 1000 queries.\n";
+            return 1;
+        }
+
+        std::string mode(argv[1]);
+        FC_ASSERT(mode == "parse" || mode == "cache", "Unknown mode ${m}", ("m", mode));
+        uint32_t count = argc > 2 ? std::stoul(argv[2]) : 1000;
+        uint32_t queries = argc > 3 ? std::stoul(argv[3]) : 1000;
+
+        auto comments = make_comments(count);
+        comment_metadata_cache cache(mode == "cache" ? comment_metadata_cache::default_max_size : 0);
+        std::set<std::string> filter_tags = {"tag7", "nsfw"};
+
+        uint64_t filtered = 0;
+        auto start = fc::time_point::now();
+        for (uint32_t q = 0; q < queries; ++q) {
+            for (const auto &c : comments) {
+                auto meta = cache.get(c);
+                for (const auto &tag : filter_tags) {
+                    if (meta->tags.count(tag)) {
+                        ++filtered;
+                        break;
+                    }
+                }
+            }
+        }
+        uint64_t time = (fc::time_point::now() - start).count();
+
+        std::cout << mode << ": " << queries << " queries of " << count << " candidates, "
+                  << filtered / queries << " filtered out by each\n"
+                  << "   " << time / queries << " us per query, "
+                  << double(time) / queries / count << " us per candidate\n";
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
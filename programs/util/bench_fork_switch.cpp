@@ -0,0 +1,93 @@
+#include <golos/chain/database.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/time.hpp>
+
+#include <iostream>
+
+/**
+ * Measures fork switches of growing depth.
+ * For each depth two nodes share a chain, the first one produces `depth` blocks on its own,
+ * the second one produces `depth + 1` blocks of a competing fork, and the first node switches.
+ *
+ * Blocks are signed with the init key, so a testnet build is needed, as for the chain tests.
+ *
+ *   bench_fork_switch [max_depth] [shared_file_size_mb]
+ */
+
+#ifndef STEEMIT_INIT_PRIVATE_KEY
+#  define STEEMIT_INIT_PRIVATE_KEY (fc::ecc::private_key::regenerate(fc::sha256::hash(BLOCKCHAIN_NAME)))
+#endif
+
+namespace {
+    using golos::chain::database;
+    using golos::chain::fork_switch_profile;
+    using golos::protocol::signed_block;
+
+    fork_switch_profile switch_fork(uint32_t depth, uint64_t shared_file_size, uint64_t &elapsed) {
+        auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+
+        fc::temp_directory data_dir1(fc::temp_directory_path());
+        fc::temp_directory data_dir2(fc::temp_directory_path());
+
+        database db1;
+        db1._log_hardforks = false;
+        db1.open(data_dir1.path(), data_dir1.path(), STEEMIT_INIT_SUPPLY, shared_file_size, chainbase::database::read_write);
+        database db2;
+        db2._log_hardforks = false;
+        db2.open(data_dir2.path(), data_dir2.path(), STEEMIT_INIT_SUPPLY, shared_file_size, chainbase::database::read_write);
+
+        for (uint32_t i = 0; i < 5; ++i) {
+            auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            db2.push_block(b);
+        }
+        for (uint32_t i = 0; i < depth; ++i) {
+            db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+        }
+
+        uint32_t next_slot = 3;
+        signed_block b;
+        for (uint32_t i = 0; i < depth; ++i) {
+            b = db2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_witness(next_slot), init_account_priv_key, database::skip_nothing);
+            next_slot = 1;
+            db1.push_block(b);
+        }
+
+        b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+        auto start = fc::time_point::now();
+        db1.push_block(b);
+        elapsed = (fc::time_point::now() - start).count();
+
+        FC_ASSERT(db1.head_block_id() == db2.head_block_id(), "Fork of depth ${d} isn't switched to", ("d", depth));
+        auto profile = db1.profiler().get_profile();
+        FC_ASSERT(!profile.recent_fork_switches.empty());
+        auto result = profile.recent_fork_switches.back();
+
+        db1.close();
+        db2.close();
+        return result;
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        uint32_t max_depth = argc > 1 ? std::stoul(argv[1]) : 10;
+        uint64_t shared_file_size = (argc > 2 ? std::stoull(argv[2]) : 1024) * 1024 * 1024;
+
+        for (uint32_t depth = 1; depth <= max_depth; ++depth) {
+            uint64_t elapsed = 0;
+            auto fork_switch = switch_fork(depth, shared_file_size, elapsed);
+            std::cout << "depth " << depth << ": "
+                      << elapsed << " us, " << fork_switch.total_time << " us under lock, "
+                      << fork_switch.prevalidate_time << " us of checks before lock\n";
+        }
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <golos/protocol/block.hpp>
+#include <golos/plugins/json_rpc/json_stream.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+#include <fc/io/json.hpp>
+#include <fc/time.hpp>
+
+#include <sys/resource.h>
+
+#include <iostream>
+
+/**
+ * Compares the two ways to write a large API result to json, on a get_blocks_with_info-like
+ * vector of blocks full of transfers:
+ *  - variant: fc::json::to_string(fc::variant(result)), the result is converted to the variant tree first;
+ *  - stream: json_stream writes the result directly.
+ *
+ * Peak memory is the peak RSS of the process, so each way runs in its own process:
+ *   bench_json_stream variant|stream [blocks] [transactions_per_block]
+ *   bench_json_stream compare [blocks] [transactions_per_block]    - checks both ways give the same json
+ */
+
+namespace {
+    using namespace golos::protocol;
+
+    std::vector<signed_block> make_blocks(uint32_t count, uint32_t transactions) {
+        auto key = fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("bench_json_stream")));
+
+        std::vector<signed_block> blocks(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto &block = blocks[i];
+            block.timestamp = fc::time_point_sec(1476788400 + i * 3);
+            block.witness = "witness";
+            for (uint32_t t = 0; t < transactions; ++t) {
+                transfer_operation op;
+                op.from = "alice";
+                op.to = "bob";
+                op.amount = asset(t + 1, STEEM_SYMBOL);
+                op.memo = "memo of transfer " + std::to_string(t) + " in block " + std::to_string(i);
+
+                signed_transaction trx;
+                trx.ref_block_num = i;
+                trx.expiration = block.timestamp + 60;
+                trx.operations.push_back(op);
+                trx.signatures.push_back(key.sign_compact(fc::sha256::hash(op.memo)));
+                block.transactions.push_back(trx);
+            }
+            block.transaction_merkle_root = block.calculate_merkle_root();
+            block.sign(key);
+        }
+        return blocks;
+    }
+
+    uint64_t peak_rss_kb() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    std::string write_json(const std::string &mode, const std::vector<signed_block> &blocks) {
+        if (mode == "variant") {
+            return fc::json::to_string(fc::variant(blocks));
+        }
+        return golos::plugins::json_rpc::to_json_string(blocks);
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 2) {
+            std::cerr << "bench_json_stream variant|stream|compare [blocks] [transactions_per_block]\n"
+                    "\n"
+                    "Defaults are 128 blocks with 200 transactions, about 8M of json.\n";
+            return 1;
+        }
+
+        std::string mode(argv[1]);
+        uint32_t count = argc > 2 ? std::stoul(argv[2]) : 128;
+        uint32_t transactions = argc > 3 ? std::stoul(argv[3]) : 200;
+
+        auto blocks = make_blocks(count, transactions);
+        auto base_rss = peak_rss_kb();
+
+        if (mode == "compare") {
+            auto variant_json = write_json("variant", blocks);
+            auto stream_json = write_json("stream", blocks);
+            FC_ASSERT(variant_json == stream_json, "json_stream output differs from fc::json");
+            std::cout << "Outputs are the same, " << stream_json.size() << " bytes\n";
+            return 0;
+        }
+
+        FC_ASSERT(mode == "variant" || mode == "stream", "Unknown mode ${m}", ("m", mode));
+
+        const uint32_t runs = 10;
+        uint64_t total_time = 0;
+        uint64_t max_time = 0;
+        size_t size = 0;
+        for (uint32_t i = 0; i < runs; ++i) {
+            auto start = fc::time_point::now();
+            size = write_json(mode, blocks).size();
+            uint64_t time = (fc::time_point::now() - start).count();
+            total_time += time;
+            max_time = std::max(max_time, time);
+        }
+
+        std::cout << mode << ": " << count << " blocks, " << size << " bytes of json\n"
+                  << "   time: " << total_time / runs << " us average, " << max_time << " us max\n"
+                  << "   peak memory above the result: " << (peak_rss_kb() - base_rss) / 1024 << "M\n";
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
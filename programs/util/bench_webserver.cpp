@@ -0,0 +1,337 @@
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/asio.hpp>
+
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+/**
+ * Load test of the webserver: concurrent clients send the same JSON-RPC request over HTTP
+ * and the latency of every response is measured. Run it against a node with the thread pool
+ * and against a node with the executor (webserver-executor = true) to compare them:
+ *  - p50 and p99 of the latency of the successful requests;
+ *  - throughput;
+ *  - number of requests rejected by the overloaded server.
+ *
+ * Over HTTP every request opens a new connection. In the websocket mode every client keeps one
+ * connection and sends the next requests without waiting for the responses, up to the window,
+ * so the per-connection queues of the executor and the turns of the connections are exercised:
+ * the spread of the throughput of the clients shows fairness, responses of one connection
+ * which came out of order are counted.
+ *
+ * In the batch mode one client sends batches of growing size, to compare latency of batches
+ * with rpc-batch-threads = 0 (requests of a batch run one after another) and with batch threads.
+ */
+
+namespace {
+    using boost::asio::ip::tcp;
+
+    using websocket_client = websocketpp::client<websocketpp::config::asio_client>;
+
+    struct client_result {
+        std::vector<uint64_t> latencies;
+        uint64_t rejected = 0;
+        uint64_t failed = 0;
+        /// successful responses with a lower id than the previous successful one
+        uint64_t out_of_order = 0;
+        double seconds = 0;
+    };
+
+    /// @return HTTP status of the response, 0 if the request failed
+    uint32_t send_request(
+        boost::asio::io_service &ios, const tcp::endpoint &endpoint, const std::string &request
+    ) {
+        boost::system::error_code ec;
+        tcp::socket socket(ios);
+        socket.connect(endpoint, ec);
+        if (ec) {
+            return 0;
+        }
+
+        boost::asio::write(socket, boost::asio::buffer(request), ec);
+        if (ec) {
+            return 0;
+        }
+
+        boost::asio::streambuf response;
+        boost::asio::read(socket, response, ec);
+        if (ec && ec != boost::asio::error::eof) {
+            return 0;
+        }
+
+        std::istream stream(&response);
+        std::string http_version;
+        uint32_t status = 0;
+        stream >> http_version >> status;
+        return status;
+    }
+
+    uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        return sorted[std::min<size_t>(sorted.size() - 1, size_t(sorted.size() * p))];
+    }
+
+    std::string make_http_request(const std::string &host, const std::string &body) {
+        return
+            "POST / HTTP/1.1\r\n"
+            "Host: " + host + "\r\n"
+            "Content-Type: application/json\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Connection: close\r\n"
+            "\r\n" + body;
+    }
+
+    const char *default_request =
+        R"({"jsonrpc":"2.0","id":1,"method":"call","params":["database_api","get_dynamic_global_properties",[]]})";
+
+    /**
+     * One websocket connection sends requests_count requests, keeping up to window of them in flight
+     */
+    void run_websocket_client(
+        const std::string &uri, const fc::mutable_variant_object &request, uint32_t requests_count, uint32_t window,
+        client_result &result
+    ) {
+        websocket_client client;
+        client.clear_access_channels(websocketpp::log::alevel::all);
+        client.clear_error_channels(websocketpp::log::elevel::all);
+        client.init_asio();
+
+        websocketpp::connection_hdl connection;
+        std::map<uint64_t, fc::time_point> sent;
+        uint64_t next_id = 0;
+        uint64_t received = 0;
+        uint64_t last_succeeded = 0;
+        auto start = fc::time_point::now();
+
+        auto send_next = [&]() {
+            if (next_id == requests_count) {
+                return;
+            }
+            auto message = request;
+            message.set("id", fc::variant(next_id));
+            sent[next_id] = fc::time_point::now();
+            ++next_id;
+            client.send(connection, fc::json::to_string(message), websocketpp::frame::opcode::text);
+        };
+
+        client.set_open_handler([&](websocketpp::connection_hdl hdl) {
+            connection = hdl;
+            for (uint32_t i = 0; i < window; ++i) {
+                send_next();
+            }
+        });
+        client.set_fail_handler([&](websocketpp::connection_hdl) {
+            result.failed += requests_count - received;
+        });
+        client.set_message_handler([&](websocketpp::connection_hdl hdl, websocket_client::message_ptr msg) {
+            ++received;
+            try {
+                auto response = fc::json::from_string(msg->get_payload()).get_object();
+                auto id = response["id"].as_uint64();
+                auto itr = sent.find(id);
+                FC_ASSERT(itr != sent.end(), "Unexpected response id ${id}", ("id", id));
+                auto latency = (fc::time_point::now() - itr->second).count();
+                sent.erase(itr);
+
+                if (!response.contains("error")) {
+                    if (!result.latencies.empty() && id < last_succeeded) {
+                        ++result.out_of_order;
+                    }
+                    last_succeeded = id;
+                    result.latencies.push_back(latency);
+                } else if (response["error"]["message"].as_string().find("overloaded") != std::string::npos) {
+                    ++result.rejected;
+                } else {
+                    ++result.failed;
+                }
+            } catch (const fc::exception &) {
+                ++result.failed;
+            }
+
+            if (received == requests_count) {
+                client.close(hdl, websocketpp::close::status::normal, "");
+            } else {
+                send_next();
+            }
+        });
+
+        websocketpp::lib::error_code ec;
+        auto con = client.get_connection(uri, ec);
+        if (ec) {
+            result.failed += requests_count;
+            return;
+        }
+        client.connect(con);
+        client.run();
+        result.seconds = std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001);
+    }
+
+    void report(uint32_t clients, uint32_t requests_per_client, double seconds, const std::vector<client_result> &results) {
+        std::vector<uint64_t> latencies;
+        uint64_t rejected = 0;
+        uint64_t failed = 0;
+        uint64_t out_of_order = 0;
+        double min_rate = 0;
+        double max_rate = 0;
+        for (const auto &result : results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            rejected += result.rejected;
+            failed += result.failed;
+            out_of_order += result.out_of_order;
+            auto rate = result.seconds > 0 ? result.latencies.size() / result.seconds : 0;
+            min_rate = &result == &results.front() ? rate : std::min(min_rate, rate);
+            max_rate = std::max(max_rate, rate);
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << clients << " clients, " << requests_per_client << " requests each, " << seconds << " sec\n"
+                  << "   succeeded: " << latencies.size() << ", " << uint64_t(latencies.size() / seconds) << " requests/s\n"
+                  << "   rejected: " << rejected << "\n"
+                  << "   failed: " << failed << "\n"
+                  << "   out of order: " << out_of_order << "\n"
+                  << "   requests/s of a client: min " << uint64_t(min_rate) << ", max " << uint64_t(max_rate) << "\n"
+                  << "   latency p50: " << percentile(latencies, 0.5) << " us\n"
+                  << "   latency p90: " << percentile(latencies, 0.9) << " us\n"
+                  << "   latency p99: " << percentile(latencies, 0.99) << " us\n"
+                  << "   latency max: " << (latencies.empty() ? 0 : latencies.back()) << " us\n";
+    }
+
+    void bench_batches(
+        const tcp::endpoint &endpoint, const std::string &host, uint32_t max_batch_size, uint32_t batches,
+        const std::string &body
+    ) {
+        boost::asio::io_service ios;
+        std::cout << "batch size, p50 us, p99 us, us per request\n";
+        for (uint32_t batch_size = 1; batch_size <= max_batch_size; batch_size *= 2) {
+            std::string batch = "[";
+            for (uint32_t i = 0; i < batch_size; ++i) {
+                batch += (i ? "," : "") + body;
+            }
+            batch += "]";
+            auto request = make_http_request(host, batch);
+
+            std::vector<uint64_t> latencies;
+            for (uint32_t n = 0; n < batches; ++n) {
+                auto request_start = fc::time_point::now();
+                auto status = send_request(ios, endpoint, request);
+                FC_ASSERT(status == 200, "Batch request failed with status ${s}", ("s", status));
+                latencies.push_back((fc::time_point::now() - request_start).count());
+            }
+            std::sort(latencies.begin(), latencies.end());
+
+            auto p50 = percentile(latencies, 0.5);
+            std::cout << "   " << batch_size << ", " << p50 << ", " << percentile(latencies, 0.99) << ", "
+                      << p50 / batch_size << "\n";
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc < 3) {
+            std::cerr << "bench_webserver <host> <port> [clients] [requests_per_client] [json_rpc_request]\n"
+                    "bench_webserver <host> <port> ws [clients] [requests_per_client] [window] [json_rpc_request]\n"
+                    "bench_webserver <host> <port> batch [max_batch_size] [batches] [json_rpc_request]\n"
+                    "\n"
+                    "Default request is get_dynamic_global_properties of database_api, 64 clients send 1000 requests each.\n"
+                    "In the websocket mode each client keeps up to window requests (8 by default) in flight.\n"
+                    "In the batch mode batches of 1, 2, 4 ... 256 requests are sent 100 times each.\n";
+            return 1;
+        }
+
+        std::string host(argv[1]);
+        std::string port(argv[2]);
+
+        boost::asio::io_service ios;
+        tcp::resolver resolver(ios);
+        auto endpoint = *resolver.resolve(tcp::resolver::query(host, port));
+
+        if (argc > 3 && std::string(argv[3]) == "batch") {
+            uint32_t max_batch_size = argc > 4 ? std::stoul(argv[4]) : 256;
+            uint32_t batches = argc > 5 ? std::stoul(argv[5]) : 100;
+            std::string body = argc > 6 ? argv[6] : default_request;
+            bench_batches(endpoint, host, max_batch_size, batches, body);
+            return 0;
+        }
+
+        if (argc > 3 && std::string(argv[3]) == "ws") {
+            uint32_t clients = argc > 4 ? std::stoul(argv[4]) : 64;
+            uint32_t requests_per_client = argc > 5 ? std::stoul(argv[5]) : 1000;
+            uint32_t window = argc > 6 ? std::stoul(argv[6]) : 8;
+            fc::mutable_variant_object request(fc::json::from_string(argc > 7 ? argv[7] : default_request).get_object());
+            std::string uri = "ws://" + host + ":" + port;
+
+            std::vector<client_result> results(clients);
+            std::vector<std::thread> threads;
+            auto start = fc::time_point::now();
+            for (uint32_t i = 0; i < clients; ++i) {
+                threads.emplace_back([&, i]() {
+                    run_websocket_client(uri, request, requests_per_client, window, results[i]);
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            report(clients, requests_per_client,
+                   std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001), results);
+            return 0;
+        }
+
+        uint32_t clients = argc > 3 ? std::stoul(argv[3]) : 64;
+        uint32_t requests_per_client = argc > 4 ? std::stoul(argv[4]) : 1000;
+        std::string body = argc > 5 ? argv[5] : default_request;
+        auto request = make_http_request(host, body);
+
+        std::vector<client_result> results(clients);
+        std::vector<std::thread> threads;
+
+        auto start = fc::time_point::now();
+        for (uint32_t i = 0; i < clients; ++i) {
+            threads.emplace_back([&, i]() {
+                boost::asio::io_service client_ios;
+                auto &result = results[i];
+                result.latencies.reserve(requests_per_client);
+                auto client_start = fc::time_point::now();
+                for (uint32_t n = 0; n < requests_per_client; ++n) {
+                    auto request_start = fc::time_point::now();
+                    auto status = send_request(client_ios, endpoint, request);
+                    auto latency = (fc::time_point::now() - request_start).count();
+                    if (status == 200) {
+                        result.latencies.push_back(latency);
+                    } else if (status == 503) {
+                        ++result.rejected;
+                    } else {
+                        ++result.failed;
+                    }
+                }
+                result.seconds = std::max(double((fc::time_point::now() - client_start).count()) / 1000000.0, 0.000001);
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        auto seconds = std::max(double((fc::time_point::now() - start).count()) / 1000000.0, 0.000001);
+
+        report(clients, requests_per_client, seconds, results);
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
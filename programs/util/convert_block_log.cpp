@@ -0,0 +1,95 @@
+#include <golos/chain/block_log.hpp>
+#include <golos/chain/compressed_block_log.hpp>
+
+#include <iostream>
+
+/**
+ * Converts the block log between the plain format used by a running node (block_log + block_log.index)
+ * and the compressed chunked format (block log v2) used to ship replay seeds.
+ */
+
+namespace {
+    void print_progress(uint32_t block_num, uint32_t head_block_num) {
+        if (block_num % 100000 == 0 || block_num == head_block_num) {
+            std::cerr << "   " << double(block_num * 100) / head_block_num << "%   "
+                      << block_num << " of " << head_block_num << "\n";
+        }
+    }
+
+    void compress(const fc::path &input, const fc::path &output, uint32_t blocks_per_chunk) {
+        golos::chain::block_log in;
+        in.open(input);
+        FC_ASSERT(in.head(), "Block log ${file} is empty", ("file", input));
+
+        golos::chain::compressed_block_log out;
+        out.create(output, blocks_per_chunk);
+
+        auto head_block_num = in.head()->block_num();
+        auto itr = in.read_block(0);
+        for (;;) {
+            auto block_num = itr.first.block_num();
+            out.append(itr.first);
+            print_progress(block_num, head_block_num);
+            if (block_num == head_block_num) {
+                break;
+            }
+            itr = in.read_block(itr.second);
+        }
+
+        out.close();
+    }
+
+    void decompress(const fc::path &input, const fc::path &output) {
+        golos::chain::compressed_block_log in;
+        in.open(input);
+
+        FC_ASSERT(!fc::exists(output) || fc::file_size(output) == 0,
+                  "Block log ${file} already exists", ("file", output));
+        golos::chain::block_log out;
+        out.open(output);
+
+        auto head_block_num = in.head_block_num();
+        for (uint32_t block_num = 1; block_num <= head_block_num; ++block_num) {
+            auto block = in.read_block_by_num(block_num);
+            FC_ASSERT(block.valid(), "Block ${n} is missing", ("n", block_num));
+            out.append(*block);
+            print_progress(block_num, head_block_num);
+        }
+
+        out.flush();
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        std::string mode = argc > 1 ? argv[1] : "";
+        if (argc < 4 || (mode != "compress" && mode != "decompress")) {
+            std::cerr << "convert_block_log compress <block_log> <compressed_block_log> [blocks_per_chunk]\n"
+                    "convert_block_log decompress <compressed_block_log> <block_log>\n"
+                    "\n"
+                    "compress reads block_log (and block_log.index) and writes the compressed chunked block log,\n"
+                    "by default " << golos::chain::compressed_block_log::default_blocks_per_chunk
+                      << " blocks are compressed together.\n"
+                    "decompress writes block_log and block_log.index back from the compressed block log.\n";
+            return 1;
+        }
+
+        if (mode == "compress") {
+            uint32_t blocks_per_chunk = golos::chain::compressed_block_log::default_blocks_per_chunk;
+            if (argc > 4) {
+                blocks_per_chunk = std::stoul(argv[4]);
+            }
+            compress(argv[2], argv[3], blocks_per_chunk);
+        } else {
+            decompress(argv[2], argv[3]);
+        }
+    } catch (const fc::exception &e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception &e) {
+        edump((std::string(e.what())));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#ifdef STEEMIT_BUILD_TESTNET
+
+#include <boost/test/unit_test.hpp>
+
+#include <golos/chain/account_object.hpp>
+#include <golos/chain/history_object.hpp>
+#include <golos/chain/account_history_store.hpp>
+#include <golos/protocol/steem_operations.hpp>
+
+#include <golos/plugins/json_rpc/plugin.hpp>
+#include <golos/plugins/database_api/plugin.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <boost/program_options.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace golos::chain;
+using namespace golos::protocol;
+using golos::plugins::json_rpc::msg_pack;
+
+namespace {
+    namespace bpo = boost::program_options;
+
+    /**
+     * The account history plugin moves the irreversible history to a store of 4 entries in a segment,
+     * the history is read back through the database_api plugin
+     */
+    struct account_history_fixture : public database_fixture {
+        fc::temp_directory store_dir;
+        std::shared_ptr<account_history_store> store;
+        golos::plugins::database_api::plugin *api_plugin = nullptr;
+
+        account_history_fixture()
+                : store_dir(golos::utilities::temp_directory_path()),
+                  store(std::make_shared<account_history_store>(4)) {
+            initialize();
+
+            auto &rpc_plugin = appbase::app().register_plugin<golos::plugins::json_rpc::plugin>();
+            api_plugin = &appbase::app().register_plugin<golos::plugins::database_api::plugin>();
+            bpo::options_description cli;
+            bpo::options_description cfg;
+            rpc_plugin.set_program_options(cli, cfg);
+            bpo::variables_map options;
+            bpo::store(bpo::command_line_parser(std::vector<std::string>()).options(cfg).run(), options);
+            bpo::notify(options);
+            api_plugin->initialize(options);
+
+            open_database();
+            store->open(store_dir.path());
+            db->set_account_history_store(store);
+            startup();
+        }
+
+        ~account_history_fixture() {
+            // the database of the chain plugin is shared by the tests
+            db->set_account_history_store(nullptr);
+        }
+
+        /// before the miner voting block the last irreversible block is STEEMIT_MAX_WITNESSES behind the head
+        uint32_t last_irreversible_block() const {
+            return db->last_non_undoable_block_num();
+        }
+
+        uint32_t count_chainbase_history(uint32_t block) const {
+            uint32_t result = 0;
+            for (const auto &item : db->get_index<account_history_index>().indices().get<by_id>()) {
+                if (db->get(item.op).block == block) {
+                    ++result;
+                }
+            }
+            return result;
+        }
+
+        void check_chainbase_is_reversible() const {
+            for (const auto &item : db->get_index<account_history_index>().indices().get<by_id>()) {
+                BOOST_CHECK_GT(db->get(item.op).block, last_irreversible_block());
+            }
+        }
+
+        transaction_id_type transfer_in_block(const fc::ecc::private_key &key, uint32_t &block) {
+            signed_transaction tx;
+            transfer_operation op;
+            op.from = "alice";
+            op.to = "bob";
+            op.amount = ASSET("1.000 GOLOS");
+            tx.operations.push_back(op);
+            tx.set_expiration(db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            tx.sign(key, db->get_chain_id());
+            db->push_transaction(tx, 0);
+            generate_block();
+            block = db->head_block_num();
+            return tx.id();
+        }
+
+        std::map<uint32_t, golos::plugins::database_api::applied_operation> get_account_history(
+            const std::string &account, uint64_t from, uint32_t limit
+        ) {
+            msg_pack msg;
+            msg.args = std::vector<fc::variant>({fc::variant(account), fc::variant(from), fc::variant(limit)});
+            return api_plugin->get_account_history(msg);
+        }
+    };
+}
+
+BOOST_FIXTURE_TEST_SUITE(account_history_store_plugin, account_history_fixture)
+
+    BOOST_AUTO_TEST_CASE(irreversible_history_in_store) {
+        try {
+            ACTORS((alice)(bob));
+            fund("alice", ASSET("100.000 GOLOS"));
+            generate_block();
+
+            std::vector<uint32_t> blocks(5);
+            std::vector<transaction_id_type> trx_ids;
+            for (uint32_t i = 0; i < 3; ++i) {
+                trx_ids.push_back(transfer_in_block(alice_private_key, blocks[i]));
+            }
+
+            BOOST_TEST_MESSAGE("--- History is moved to the store when the block becomes irreversible");
+            while (last_irreversible_block() < blocks[0]) {
+                generate_block();
+            }
+            BOOST_REQUIRE_EQUAL(last_irreversible_block(), blocks[0]);
+            BOOST_CHECK_EQUAL(store->head_block(), blocks[0]);
+            BOOST_CHECK_EQUAL(count_chainbase_history(blocks[0]), 0);
+            check_chainbase_is_reversible();
+            auto alice_stored = store->get_account_size("alice");
+            auto bob_stored = store->get_account_size("bob");
+            BOOST_REQUIRE_GT(alice_stored, 0);
+
+            BOOST_TEST_MESSAGE("--- Popped block brings the moved history back, it isn't appended twice");
+            db->pop_block();
+            BOOST_CHECK_LT(last_irreversible_block(), blocks[0]);
+            BOOST_CHECK_GT(count_chainbase_history(blocks[0]), 0);
+            generate_block();
+            BOOST_CHECK_EQUAL(count_chainbase_history(blocks[0]), 0);
+            BOOST_CHECK_EQUAL(store->head_block(), blocks[0]);
+            BOOST_CHECK_EQUAL(store->get_account_size("alice"), alice_stored);
+            BOOST_CHECK_EQUAL(store->get_account_size("bob"), bob_stored);
+
+            while (last_irreversible_block() < blocks[2]) {
+                generate_block();
+            }
+            for (uint32_t i = 3; i < 5; ++i) {
+                trx_ids.push_back(transfer_in_block(alice_private_key, blocks[i]));
+            }
+            BOOST_REQUIRE_LT(last_irreversible_block(), blocks[3]);
+            check_chainbase_is_reversible();
+            alice_stored = store->get_account_size("alice");
+
+            BOOST_TEST_MESSAGE("--- Account history is merged from the store and chainbase");
+            auto history = get_account_history("alice", 10000, 1000);
+            BOOST_REQUIRE_GT(history.size(), alice_stored);
+            std::vector<uint32_t> transfer_blocks;
+            uint32_t sequence = 0;
+            uint32_t prev_block = 0;
+            for (const auto &item : history) {
+                BOOST_CHECK_EQUAL(item.first, sequence++);
+                BOOST_CHECK_LE(prev_block, item.second.block);
+                prev_block = item.second.block;
+                if (item.second.op.which() == operation::tag<transfer_operation>::value &&
+                    item.second.op.get<transfer_operation>().to == "bob") {
+                    transfer_blocks.push_back(item.second.block);
+                }
+            }
+            BOOST_CHECK(transfer_blocks == blocks);
+
+            // the last operation of the store and the first one of chainbase
+            auto boundary = get_account_history("alice", alice_stored, 2);
+            BOOST_REQUIRE_EQUAL(boundary.size(), 3);
+            BOOST_CHECK_EQUAL(boundary.begin()->first, alice_stored - 2);
+            BOOST_CHECK_LE(boundary[alice_stored - 1].block, last_irreversible_block());
+            BOOST_CHECK_GT(boundary[alice_stored].block, last_irreversible_block());
+            for (const auto &item : boundary) {
+                BOOST_CHECK(history[item.first].trx_id == item.second.trx_id);
+            }
+
+            BOOST_TEST_MESSAGE("--- Operations of the irreversible block are read from the store");
+            msg_pack msg;
+            msg.args = std::vector<fc::variant>({fc::variant(blocks[1]), fc::variant(false)});
+            auto ops = api_plugin->get_ops_in_block(msg);
+            uint32_t transfers = 0;
+            for (const auto &op : ops) {
+                BOOST_CHECK_EQUAL(op.block, blocks[1]);
+                if (op.op.which() == operation::tag<transfer_operation>::value) {
+                    BOOST_CHECK(op.trx_id == trx_ids[1]);
+                    ++transfers;
+                }
+            }
+            BOOST_CHECK_EQUAL(transfers, 1);
+
+            BOOST_TEST_MESSAGE("--- Transactions are found only in the reversible blocks");
+            msg.args = std::vector<fc::variant>({fc::variant(trx_ids[3])});
+            BOOST_CHECK_EQUAL(api_plugin->get_transaction(msg).block_num, blocks[3]);
+            msg.args = std::vector<fc::variant>({fc::variant(trx_ids[1])});
+            STEEMIT_REQUIRE_THROW(api_plugin->get_transaction(msg), fc::exception);
+        } FC_LOG_AND_RETHROW()
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,120 @@
+#include <boost/test/unit_test.hpp>
+
+#include <golos/plugins/social_network/comment_metadata_cache.hpp>
+
+using golos::plugins::social_network::comment_api_object;
+using golos::plugins::social_network::discussion_query;
+using golos::plugins::social_network::comment_metadata_cache;
+using golos::plugins::social_network::parse_comment_metadata;
+using golos::plugins::social_network::languages_filter;
+using golos::plugins::social_network::tags_filter;
+
+namespace {
+    comment_api_object make_comment(int64_t id, const std::string &tag) {
+        comment_api_object c;
+        c.id = golos::chain::comment_object::id_type(id);
+        c.json_metadata = R"({"tags":[")" + tag + R"("],"language":"ru"})";
+        c.last_update = fc::time_point_sec(1476788400);
+        return c;
+    }
+
+    std::string first_tag(comment_metadata_cache &cache, const comment_api_object &c) {
+        auto metadata = cache.get(c);
+        return metadata->tags.empty() ? std::string() : *metadata->tags.begin();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(comment_metadata_cache_tests)
+
+    BOOST_AUTO_TEST_CASE(malformed_metadata) {
+        BOOST_CHECK(parse_comment_metadata("")->tags.empty());
+        BOOST_CHECK(parse_comment_metadata("{\"tags\":[\"golos\"")->tags.empty());
+        BOOST_CHECK(parse_comment_metadata("[1, 2]")->tags.empty());
+        BOOST_CHECK(parse_comment_metadata("\"string\"")->language.empty());
+
+        // a malformed field doesn't hide the other one
+        auto metadata = parse_comment_metadata(R"({"tags":{"a":1},"language":"en"})");
+        BOOST_CHECK(metadata->tags.empty());
+        BOOST_CHECK_EQUAL(metadata->language, "en");
+        metadata = parse_comment_metadata(R"({"tags":["golos"],"language":[1]})");
+        BOOST_CHECK(metadata->tags == std::set<std::string>({"golos"}));
+        BOOST_CHECK(metadata->language.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(edit_invalidates_entry) {
+        comment_metadata_cache cache(10);
+        auto c = make_comment(1, "first");
+        BOOST_CHECK_EQUAL(first_tag(cache, c), "first");
+        BOOST_CHECK_EQUAL(cache.get(c)->language, "ru");
+
+        // the edit in another block changes last_update
+        c = make_comment(1, "second");
+        c.last_update += STEEMIT_BLOCK_INTERVAL;
+        BOOST_CHECK_EQUAL(first_tag(cache, c), "second");
+
+        // the edit in the same block keeps last_update, the entry is valid until the comment_operation erases it
+        c = make_comment(1, "third");
+        c.last_update += STEEMIT_BLOCK_INTERVAL;
+        BOOST_CHECK_EQUAL(first_tag(cache, c), "second");
+        cache.erase(c.id);
+        BOOST_CHECK_EQUAL(first_tag(cache, c), "third");
+
+        // erasing a comment which isn't cached does nothing
+        cache.erase(golos::chain::comment_object::id_type(2));
+        BOOST_CHECK_EQUAL(first_tag(cache, c), "third");
+    }
+
+    BOOST_AUTO_TEST_CASE(lru_bound) {
+        comment_metadata_cache cache(2);
+        auto c1 = make_comment(1, "one");
+        auto c2 = make_comment(2, "two");
+        auto c3 = make_comment(3, "three");
+        first_tag(cache, c1);
+        first_tag(cache, c2);
+        // c1 becomes the most recently used one, c2 is evicted by c3
+        first_tag(cache, c1);
+        first_tag(cache, c3);
+
+        // an entry in the cache returns the old metadata for the same last_update, an evicted one is parsed again
+        c1.json_metadata = R"({"tags":["changed"]})";
+        c2.json_metadata = R"({"tags":["changed"]})";
+        BOOST_CHECK_EQUAL(first_tag(cache, c1), "one");
+        BOOST_CHECK_EQUAL(first_tag(cache, c2), "changed");
+        // c2 has evicted c3
+        c3.json_metadata = R"({"tags":["changed"]})";
+        BOOST_CHECK_EQUAL(first_tag(cache, c3), "changed");
+
+        // shrinking keeps the most recently used entry
+        cache.set_max_size(1);
+        c3.json_metadata = R"({"tags":["three"]})";
+        BOOST_CHECK_EQUAL(first_tag(cache, c3), "changed");
+        BOOST_CHECK_EQUAL(first_tag(cache, c1), "changed");
+
+        // nothing is cached with the size of 0
+        cache.set_max_size(0);
+        BOOST_CHECK_EQUAL(first_tag(cache, c3), "three");
+        c3.json_metadata = R"({"tags":["again"]})";
+        BOOST_CHECK_EQUAL(first_tag(cache, c3), "again");
+    }
+
+    BOOST_AUTO_TEST_CASE(filters_without_cache) {
+        // the cache keeps no metadata, the filters hold the parsed one while they use it
+        comment_metadata_cache cache(0);
+        auto c = make_comment(1, "golos");
+        auto pass = [](const comment_api_object &) { return false; };
+
+        discussion_query query;
+        query.filter_languages.insert("ru");
+        BOOST_CHECK(languages_filter(cache, query, c, pass));
+        query.filter_languages = {"en"};
+        BOOST_CHECK(!languages_filter(cache, query, c, pass));
+        c.json_metadata = R"({"tags":["golos"]})";
+        BOOST_CHECK(languages_filter(cache, query, c, pass));
+
+        query.filter_tags.insert("golos");
+        BOOST_CHECK(tags_filter(cache, query, c, pass));
+        query.filter_tags = {"other"};
+        BOOST_CHECK(!tags_filter(cache, query, c, pass));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
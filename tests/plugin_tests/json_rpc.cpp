@@ -0,0 +1,112 @@
+#include <boost/test/unit_test.hpp>
+
+#include <golos/plugins/json_rpc/plugin.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using golos::plugins::json_rpc::msg_pack;
+
+namespace {
+    namespace bpo = boost::program_options;
+
+    /**
+     * json_rpc plugin with the test_api and the serial_api, both have the work method:
+     * it takes the index of the request and the time to work in ms, and returns the index
+     */
+    struct json_rpc_fixture {
+        golos::plugins::json_rpc::plugin rpc;
+        std::atomic<uint32_t> running{0};
+        std::atomic<uint32_t> max_running{0};
+
+        explicit json_rpc_fixture(uint32_t batch_threads) {
+            bpo::options_description cli;
+            bpo::options_description cfg;
+            rpc.set_program_options(cli, cfg);
+
+            std::vector<std::string> args = {
+                "--rpc-batch-threads=" + std::to_string(batch_threads),
+                "--rpc-serial-api=serial_api"
+            };
+            bpo::variables_map options;
+            bpo::store(bpo::command_line_parser(args).options(cfg).run(), options);
+            bpo::notify(options);
+            rpc.plugin_initialize(options);
+
+            auto work = [this](msg_pack &args) -> fc::variant {
+                auto now_running = ++running;
+                auto max = max_running.load();
+                while (now_running > max && !max_running.compare_exchange_weak(max, now_running)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(args.args->at(1).as_uint64()));
+                --running;
+                return args.args->at(0);
+            };
+            rpc.add_api_method("test_api", "work", work);
+            rpc.add_api_method("serial_api", "work", work);
+        }
+
+        ~json_rpc_fixture() {
+            rpc.plugin_shutdown();
+        }
+
+        /// earlier requests work longer, so they would finish later if the order wasn't kept
+        std::string make_batch(uint32_t size, const std::string &serial_api_at = std::string()) {
+            std::string batch = "[";
+            for (uint32_t i = 0; i < size; ++i) {
+                auto api = i == 0 && !serial_api_at.empty() ? serial_api_at : std::string("test_api");
+                batch += (i ? "," : "");
+                batch += R"({"jsonrpc":"2.0","id":)" + std::to_string(i) +
+                    R"(,"method":"call","params":[")" + api + R"(","work",[)" + std::to_string(i) + "," +
+                    std::to_string((size - i) * 20) + "]]}";
+            }
+            return batch + "]";
+        }
+
+        fc::variants call(const std::string &body) {
+            std::string response;
+            uint32_t responses = 0;
+            rpc.call(body, [&](const std::string &data) {
+                response = data;
+                ++responses;
+            });
+            // the call returns when all requests of the batch have returned
+            BOOST_REQUIRE_EQUAL(responses, 1);
+            return fc::json::from_string(response).get_array();
+        }
+
+        void check_order(const fc::variants &responses, uint32_t size) {
+            BOOST_REQUIRE_EQUAL(responses.size(), size);
+            for (uint32_t i = 0; i < size; ++i) {
+                const auto &response = responses[i].get_object();
+                BOOST_CHECK_EQUAL(response["id"].as_uint64(), i);
+                BOOST_CHECK_EQUAL(response["result"].as_uint64(), i);
+            }
+        }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(json_rpc_batch)
+
+    BOOST_AUTO_TEST_CASE(parallel_batch_keeps_order) {
+        json_rpc_fixture fixture(4);
+        fixture.check_order(fixture.call(fixture.make_batch(8)), 8);
+        BOOST_CHECK_GT(fixture.max_running.load(), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(serial_api_runs_batch_serially) {
+        json_rpc_fixture fixture(4);
+        fixture.check_order(fixture.call(fixture.make_batch(8, "serial_api")), 8);
+        BOOST_CHECK_EQUAL(fixture.max_running.load(), 1);
+    }
+
+    BOOST_AUTO_TEST_CASE(batch_without_workers_runs_serially) {
+        json_rpc_fixture fixture(0);
+        fixture.check_order(fixture.call(fixture.make_batch(4)), 4);
+        BOOST_CHECK_EQUAL(fixture.max_running.load(), 1);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,157 @@
+#include <boost/test/unit_test.hpp>
+
+#include <golos/plugins/json_rpc/json_stream.hpp>
+#include <golos/plugins/block_info/block_info.hpp>
+#include <golos/plugins/database_api/applied_operation.hpp>
+#include <golos/plugins/social_network/api_object/discussion.hpp>
+
+#include <fc/io/json.hpp>
+
+using namespace golos::protocol;
+using golos::plugins::json_rpc::to_json_string;
+using golos::plugins::block_info::block_with_info;
+using golos::plugins::database_api::applied_operation;
+using golos::plugins::social_network::discussion;
+using golos::plugins::social_network::vote_state;
+
+namespace {
+    template<typename T>
+    void check_same_json(const T &value) {
+        static_assert(golos::plugins::json_rpc::is_json_streamable<T>::value, "the type isn't written by json_stream");
+        BOOST_CHECK_EQUAL(to_json_string(value), fc::json::to_string(fc::variant(value)));
+    }
+
+    signed_block make_block(uint32_t transactions) {
+        auto key = fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("json_stream")));
+
+        signed_block block;
+        block.timestamp = fc::time_point_sec(1476788400);
+        block.witness = "witness";
+        for (uint32_t t = 0; t < transactions; ++t) {
+            transfer_operation transfer;
+            transfer.from = "alice";
+            transfer.to = "bob";
+            transfer.amount = asset(t + 1, STEEM_SYMBOL);
+            transfer.memo = "memo with \"quotes\", \\ and unicode \xD0\xB3\xD0\xBE\xD0\xBB\xD0\xBE\xD1\x81";
+
+            vote_operation vote;
+            vote.voter = "bob";
+            vote.author = "alice";
+            vote.permlink = "post-" + std::to_string(t);
+            vote.weight = -STEEMIT_100_PERCENT;
+
+            signed_transaction trx;
+            trx.ref_block_num = t;
+            trx.ref_block_prefix = 0xFFFFFFFF;
+            trx.expiration = block.timestamp + 60;
+            trx.operations.push_back(transfer);
+            trx.operations.push_back(vote);
+            trx.sign(key, STEEMIT_CHAIN_ID);
+            block.transactions.push_back(trx);
+        }
+        block.transaction_merkle_root = block.calculate_merkle_root();
+        block.sign(key);
+        return block;
+    }
+
+    discussion make_discussion() {
+        discussion d;
+        d.id = golos::chain::comment_object::id_type(42);
+        d.author = "alice";
+        d.permlink = "post";
+        d.category = "golos";
+        d.title = "Title";
+        d.body = "Body\nwith lines";
+        d.json_metadata = R"({"tags":["golos"]})";
+        d.last_update = fc::time_point_sec(1476788400);
+        d.depth = 0;
+        d.children = 2;
+        d.children_rshares2 = fc::uint128_t(123456789);
+        d.net_rshares = -100;
+        d.total_vote_weight = 1000;
+        d.reward_weight = STEEMIT_100_PERCENT;
+        d.net_votes = -1;
+        d.max_accepted_payout = asset(1000000000, SBD_SYMBOL);
+        d.percent_steem_dollars = STEEMIT_100_PERCENT;
+        d.allow_replies = true;
+        d.allow_votes = true;
+        d.allow_curation_rewards = false;
+        d.beneficiaries.push_back(beneficiary_route_type(account_name_type("bob"), 500));
+
+        d.url = "/golos/@alice/post";
+        d.root_title = "Title";
+        vote_state vote;
+        vote.voter = "bob";
+        vote.weight = 10;
+        vote.rshares = -5;
+        vote.percent = -10000;
+        vote.time = fc::time_point_sec(1476788403);
+        d.active_votes.push_back(vote);
+        d.replies.push_back("bob/re-post");
+        d.author_reputation = 1000;
+        d.body_length = 15;
+        return d;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(json_stream_tests)
+
+    BOOST_AUTO_TEST_CASE(signed_block_with_transactions) {
+        check_same_json(make_block(3));
+        check_same_json(make_block(0));
+        check_same_json(std::vector<signed_block>{make_block(1), make_block(2)});
+    }
+
+    BOOST_AUTO_TEST_CASE(block_with_info_result) {
+        block_with_info result;
+        result.block = make_block(2);
+        result.info.block_id = result.block.id();
+        result.info.block_size = fc::raw::pack_size(result.block);
+        result.info.average_block_size = 100;
+        result.info.aslot = 12345;
+        result.info.last_irreversible_block_num = 10;
+        result.info.num_pow_witnesses = 1;
+        check_same_json(result);
+        check_same_json(std::vector<block_with_info>{result, result});
+    }
+
+    BOOST_AUTO_TEST_CASE(applied_operation_map) {
+        std::map<uint32_t, applied_operation> result;
+        auto block = make_block(2);
+        uint32_t seq = 0;
+        for (uint32_t t = 0; t < block.transactions.size(); ++t) {
+            for (uint16_t o = 0; o < block.transactions[t].operations.size(); ++o) {
+                auto &op = result[seq++];
+                op.trx_id = block.transactions[t].id();
+                op.block = 5;
+                op.trx_in_block = t;
+                op.op_in_trx = o;
+                op.timestamp = block.timestamp;
+                op.op = block.transactions[t].operations[o];
+            }
+        }
+        auto &virtual_op = result[seq];
+        virtual_op.block = 5;
+        virtual_op.virtual_op = 1;
+        virtual_op.op = author_reward_operation("alice", "post", asset(1, SBD_SYMBOL), asset(2, STEEM_SYMBOL), asset(3, VESTS_SYMBOL));
+
+        check_same_json(result);
+        check_same_json(std::map<uint32_t, applied_operation>());
+    }
+
+    BOOST_AUTO_TEST_CASE(discussion_optionals) {
+        auto empty_optionals = make_discussion();
+        check_same_json(empty_optionals);
+
+        auto set_optionals = make_discussion();
+        set_optionals.first_reblogged_by = account_name_type("bob");
+        set_optionals.first_reblogged_on = fc::time_point_sec(1476788406);
+        set_optionals.reblogged_by.push_back("bob");
+        check_same_json(set_optionals);
+
+        check_same_json(std::vector<discussion>{empty_optionals, set_optionals});
+        check_same_json(fc::optional<discussion>());
+        check_same_json(fc::optional<discussion>(set_optionals));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
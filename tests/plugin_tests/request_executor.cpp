@@ -0,0 +1,141 @@
+#include <boost/test/unit_test.hpp>
+
+#include <golos/plugins/webserver/request_executor.hpp>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using golos::plugins::webserver::request_executor;
+
+namespace {
+    /**
+     * Occupies a worker of the executor until it is opened
+     */
+    struct gate {
+        std::promise<void> started;
+        std::promise<void> opened;
+
+        void post(request_executor &executor, const void *connection) {
+            auto opened_future = opened.get_future().share();
+            BOOST_REQUIRE(executor.post(connection, [this, opened_future]() {
+                started.set_value();
+                opened_future.wait();
+            }));
+            started.get_future().wait();
+        }
+
+        void open() {
+            opened.set_value();
+        }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(request_executor_tests)
+
+    BOOST_AUTO_TEST_CASE(connection_order) {
+        request_executor executor(4, 1000, 1000);
+        int connection;
+
+        std::mutex mutex;
+        std::vector<uint32_t> order;
+        std::atomic<uint32_t> running{0};
+        std::atomic<uint32_t> max_running{0};
+        std::promise<void> done;
+
+        const uint32_t count = 100;
+        for (uint32_t i = 0; i < count; ++i) {
+            BOOST_REQUIRE(executor.post(&connection, [&, i]() {
+                auto now_running = ++running;
+                if (now_running > max_running) {
+                    max_running = now_running;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    order.push_back(i);
+                }
+                --running;
+                if (i + 1 == count) {
+                    done.set_value();
+                }
+            }));
+        }
+        done.get_future().wait();
+
+        // requests of one connection run one at a time in the order they came
+        BOOST_CHECK_EQUAL(max_running.load(), 1);
+        BOOST_REQUIRE_EQUAL(order.size(), count);
+        for (uint32_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(order[i], i);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(connections_take_turns) {
+        request_executor executor(1, 1000, 1000);
+        int blocker, first, second;
+
+        gate g;
+        g.post(executor, &blocker);
+
+        std::vector<std::string> order;
+        std::promise<void> done;
+        for (uint32_t i = 1; i <= 3; ++i) {
+            BOOST_REQUIRE(executor.post(&first, [&, i]() {
+                order.push_back("a" + std::to_string(i));
+            }));
+        }
+        for (uint32_t i = 1; i <= 3; ++i) {
+            BOOST_REQUIRE(executor.post(&second, [&, i]() {
+                order.push_back("b" + std::to_string(i));
+                if (i == 3) {
+                    done.set_value();
+                }
+            }));
+        }
+
+        g.open();
+        done.get_future().wait();
+
+        std::vector<std::string> expected = {"a1", "b1", "a2", "b2", "a3", "b3"};
+        BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected.begin(), expected.end());
+    }
+
+    BOOST_AUTO_TEST_CASE(rejection) {
+        // 4 queued requests in total, 2 of one connection
+        request_executor executor(1, 4, 2);
+        int blocker, first, second, third;
+
+        gate g;
+        g.post(executor, &blocker);
+
+        std::atomic<uint32_t> executed{0};
+        auto task = [&]() { ++executed; };
+
+        BOOST_CHECK(executor.post(&first, task));
+        BOOST_CHECK(executor.post(&first, task));
+        // the queue of the connection is full
+        BOOST_CHECK(!executor.post(&first, task));
+
+        BOOST_CHECK(executor.post(&second, task));
+        BOOST_CHECK(executor.post(&second, task));
+        // the queue of the executor is full, though the connection has nothing queued
+        BOOST_CHECK(!executor.post(&third, task));
+
+        std::promise<void> done;
+        g.open();
+        // the queues are drained, then a request fits again
+        while (executed.load() < 4) {
+            std::this_thread::yield();
+        }
+        BOOST_CHECK(executor.post(&third, [&]() { done.set_value(); }));
+        done.get_future().wait();
+        BOOST_CHECK_EQUAL(executed.load(), 4);
+
+        executor.stop();
+        BOOST_CHECK(!executor.post(&third, task));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,7 @@
 #include <boost/test/unit_test_monitor.hpp>
 
 #include <golos/chain/database.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include "../common/database_fixture.hpp"
@@ -313,4 +314,82 @@ BOOST_FIXTURE_TEST_SUITE(basic_tests, clean_database_fixture)
         BOOST_CHECK(block.calculate_merkle_root() == c(dO));
     }
 
+    BOOST_AUTO_TEST_CASE(signature_keys_cache_test) {
+        auto &cache = signature_keys_cache::instance();
+        cache.clear();
+
+        auto alice_key = generate_private_key("alice");
+        auto bob_key = generate_private_key("bob");
+
+        signed_transaction trx;
+        transfer_operation op;
+        op.from = "alice";
+        op.to = "bob";
+        op.amount = asset(100, STEEM_SYMBOL);
+        trx.operations.push_back(op);
+        trx.set_expiration(db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+        trx.sign(alice_key, db->get_chain_id());
+
+        auto stats = cache.get_stats();
+        auto keys = trx.get_signature_keys(db->get_chain_id());
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 1);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 1);
+
+        BOOST_CHECK(trx.get_signature_keys(db->get_chain_id()) == keys);
+        BOOST_CHECK_EQUAL(cache.get_stats().hits, stats.hits + 1);
+
+        // the digest doesn't cover signatures, other signatures should not hit the cached keys
+        trx.sign(bob_key, db->get_chain_id());
+        keys = trx.get_signature_keys(db->get_chain_id());
+        BOOST_CHECK_EQUAL(keys.size(), 2);
+        BOOST_CHECK(keys.count(alice_key.get_public_key()));
+        BOOST_CHECK(keys.count(bob_key.get_public_key()));
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 2);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 1);
+
+        // another chain id gives another digest
+        trx.get_signature_keys(fc::sha256::hash("other chain"));
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 3);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 2);
+
+        // the least recently used entry is evicted
+        cache.set_max_size(1);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 1);
+        trx.get_signature_keys(fc::sha256::hash("other chain"));
+        BOOST_CHECK_EQUAL(cache.get_stats().hits, stats.hits + 2);
+        trx.get_signature_keys(db->get_chain_id());
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 4);
+
+        cache.set_max_size(signature_keys_cache::default_max_size);
+        cache.clear();
+    }
+
+    BOOST_AUTO_TEST_CASE(signature_keys_cache_disabled) {
+        ACTORS((alice))
+        fund("alice", 10000);
+
+        auto &cache = signature_keys_cache::instance();
+        cache.set_max_size(0);
+        BOOST_CHECK(!cache.enabled());
+
+        signed_transaction trx;
+        transfer_operation op;
+        op.from = "alice";
+        op.to = STEEMIT_INIT_MINER_NAME;
+        op.amount = asset(100, STEEM_SYMBOL);
+        trx.operations.push_back(op);
+        trx.set_expiration(db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+        trx.sign(alice_private_key, db->get_chain_id());
+
+        // without the cache keys aren't recovered in advance, only once under the lock
+        auto stats = cache.get_stats();
+        db->push_transaction(trx, 0);
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 1);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 0);
+
+        cache.set_max_size(signature_keys_cache::default_max_size);
+        BOOST_CHECK(cache.enabled());
+        cache.clear();
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
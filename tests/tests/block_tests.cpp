@@ -30,6 +30,9 @@
 #include <golos/chain/database.hpp>
 #include <golos/chain/steem_objects.hpp>
 #include <golos/chain/history_object.hpp>
+#include <golos/chain/compressed_block_log.hpp>
+#include <golos/chain/account_history_store.hpp>
+#include <golos/chain/state_snapshot.hpp>
 
 #include <golos/plugins/account_history/plugin.hpp>
 
@@ -37,6 +40,11 @@
 
 #include <fc/crypto/digest.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
 #include "../common/database_fixture.hpp"
 
 using namespace golos;
@@ -104,6 +112,262 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(reindex_blocks) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            signed_block cutoff_block;
+            {
+                database db;
+                db._log_hardforks = false;
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                for (;;) {
+                    db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                    uint32_t cutoff_height = db.get_dynamic_global_properties().last_irreversible_block_num;
+                    if (cutoff_height >= 100) {
+                        auto block = db.fetch_block_by_number(cutoff_height);
+                        BOOST_REQUIRE(block.valid());
+                        cutoff_block = *block;
+                        break;
+                    }
+                }
+                db.close();
+            }
+            {
+                database db;
+                db._log_hardforks = false;
+                // a queue much shorter than the chain makes the reader wait for the replaying thread
+                db.set_replay_queue_size(4);
+                db.reindex(data_dir.path(), data_dir.path(), TEST_SHARED_MEM_SIZE);
+                BOOST_CHECK_EQUAL(db.head_block_num(), cutoff_block.block_num());
+                BOOST_CHECK(db.head_block_id() == cutoff_block.id());
+
+                auto b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                BOOST_CHECK_EQUAL(db.head_block_num(), cutoff_block.block_num() + 1);
+                BOOST_CHECK(db.head_block_id() == b.id());
+            }
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(block_log_read_while_append) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            block_log log;
+            log.open(data_dir.path() / "block_log");
+
+            std::vector<signed_block> blocks(200);
+            for (uint32_t i = 0; i < blocks.size(); ++i) {
+                blocks[i].previous = i == 0 ? block_id_type() : blocks[i - 1].id();
+                blocks[i].witness = "initminer";
+            }
+
+            // the first blocks are appended before the readers start, the rest while they read
+            for (uint32_t i = 0; i < 10; ++i) {
+                log.append(blocks[i]);
+
+                // every read after an append has to see the grown file
+                auto read = log.read_block_by_num(blocks[i].block_num());
+                BOOST_REQUIRE(read.valid());
+                BOOST_CHECK(read->id() == blocks[i].id());
+            }
+
+            std::atomic<bool> appending{true};
+            std::atomic<uint32_t> errors{0};
+            std::atomic<uint32_t> reads_during_append{0};
+            std::vector<std::thread> readers;
+            for (uint32_t t = 0; t < 4; ++t) {
+                readers.emplace_back([&, t]() {
+                    uint32_t n = t;
+                    while (appending) {
+                        // a block is either not appended yet or is read whole
+                        n = n % blocks.size() + 1;
+                        auto read = log.read_block_by_num(n);
+                        if (read.valid()) {
+                            if (read->id() != blocks[n - 1].id()) {
+                                ++errors;
+                            }
+                            ++reads_during_append;
+                        }
+                    }
+                });
+            }
+
+            std::thread writer([&]() {
+                for (uint32_t i = 10; i < blocks.size(); ++i) {
+                    log.append(blocks[i]);
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                appending = false;
+            });
+
+            writer.join();
+            for (auto &reader : readers) {
+                reader.join();
+            }
+            BOOST_CHECK_EQUAL(errors.load(), 0);
+            BOOST_CHECK(reads_during_append.load() > 0);
+            for (uint32_t n = 1; n <= blocks.size(); ++n) {
+                auto read = log.read_block_by_num(n);
+                BOOST_REQUIRE(read.valid());
+                BOOST_CHECK(read->id() == blocks[n - 1].id());
+            }
+            BOOST_CHECK(!log.read_block_by_num(blocks.size() + 1).valid());
+
+            log.close();
+            log.open(data_dir.path() / "block_log");
+            BOOST_REQUIRE(log.head().valid());
+            BOOST_CHECK(log.head()->id() == blocks.back().id());
+            BOOST_CHECK(log.read_block_by_num(1)->id() == blocks.front().id());
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(compressed_block_log_read) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            std::vector<block_id_type> ids;
+            {
+                compressed_block_log log;
+                log.create(data_dir.path() / "block_log.v2", 16);
+
+                signed_block b;
+                for (uint32_t i = 0; i < 40; ++i) {
+                    b.previous = ids.empty() ? block_id_type() : ids.back();
+                    b.witness = "initminer";
+                    log.append(b);
+                    ids.push_back(b.id());
+                }
+                STEEMIT_REQUIRE_THROW(log.append(b), fc::exception);
+                log.close();
+            }
+
+            compressed_block_log log;
+            log.open(data_dir.path() / "block_log.v2");
+            BOOST_CHECK_EQUAL(log.head_block_num(), ids.size());
+            BOOST_CHECK_EQUAL(log.blocks_per_chunk(), 16);
+
+            // out of order reads go across chunks, including the last partial one
+            for (uint32_t n : {40, 1, 17, 16, 33, 2}) {
+                auto block = log.read_block_by_num(n);
+                BOOST_REQUIRE(block.valid());
+                BOOST_CHECK(block->id() == ids[n - 1]);
+            }
+            for (uint32_t n = 1; n <= ids.size(); ++n) {
+                BOOST_CHECK(log.read_block_by_num(n)->id() == ids[n - 1]);
+            }
+            BOOST_CHECK(!log.read_block_by_num(0).valid());
+            BOOST_CHECK(!log.read_block_by_num(ids.size() + 1).valid());
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(account_history_store_segments) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            auto dir = data_dir.path() / "account_history";
+
+            auto make_record = [](uint32_t block) {
+                account_history_record record;
+                record.block = block;
+                record.serialized_op.push_back(char(block));
+                record.accounts.emplace_back("alice", block - 1);
+                if (block % 2 == 0) {
+                    record.accounts.emplace_back("bob", block / 2 - 1);
+                }
+                return record;
+            };
+
+            auto check_history = [](const account_history_store &store) {
+                BOOST_CHECK_EQUAL(store.head_block(), 10);
+                BOOST_CHECK_EQUAL(store.get_account_size("alice"), 10);
+                BOOST_CHECK_EQUAL(store.get_account_size("bob"), 5);
+                BOOST_CHECK_EQUAL(store.get_account_size("carol"), 0);
+
+                // the range goes across the full segments and the active one
+                std::vector<uint32_t> sequences;
+                store.get_history("alice", 2, 8, [&](uint32_t sequence, const account_history_record &record) {
+                    BOOST_CHECK_EQUAL(record.block, sequence + 1);
+                    BOOST_CHECK_EQUAL(record.serialized_op.size(), 1);
+                    sequences.push_back(sequence);
+                });
+                BOOST_CHECK(sequences == std::vector<uint32_t>({8, 7, 6, 5, 4, 3, 2}));
+
+                sequences.clear();
+                store.get_history("bob", 0, 100, [&](uint32_t sequence, const account_history_record &record) {
+                    BOOST_CHECK_EQUAL(record.block, (sequence + 1) * 2);
+                    sequences.push_back(sequence);
+                });
+                BOOST_CHECK(sequences == std::vector<uint32_t>({4, 3, 2, 1, 0}));
+
+                store.get_history("carol", 0, 100, [&](uint32_t, const account_history_record &) {
+                    BOOST_FAIL("carol has no history");
+                });
+            };
+
+            {
+                account_history_store store(4);
+                store.open(dir);
+                for (uint32_t block = 1; block <= 10; ++block) {
+                    store.append(make_record(block));
+                }
+                store.flush();
+                check_history(store);
+
+                // sequences of an account have no gaps
+                auto record = make_record(11);
+                record.accounts[0].second = 20;
+                STEEMIT_REQUIRE_THROW(store.append(record), fc::exception);
+                store.close();
+            }
+
+            account_history_store store(4);
+            store.open(dir);
+            check_history(store);
+
+            // blocks are found in the full segments and in the active one
+            for (uint32_t block = 1; block <= 11; ++block) {
+                std::vector<uint32_t> blocks;
+                store.get_block_history(block, [&](const account_history_record &record) {
+                    blocks.push_back(record.block);
+                });
+                BOOST_CHECK_EQUAL(blocks.size(), block <= 10 ? 1 : 0);
+                BOOST_CHECK(blocks.empty() || blocks.front() == block);
+            }
+
+            // the blocks after the head of the state are removed, full segments become active again
+            store.truncate(5);
+            BOOST_CHECK_EQUAL(store.head_block(), 5);
+            BOOST_CHECK_EQUAL(store.get_account_size("alice"), 5);
+            BOOST_CHECK_EQUAL(store.get_account_size("bob"), 2);
+            store.get_block_history(6, [&](const account_history_record &) {
+                BOOST_FAIL("block 6 is truncated");
+            });
+            for (uint32_t block = 6; block <= 10; ++block) {
+                store.append(make_record(block));
+            }
+            store.flush();
+            check_history(store);
+            store.close();
+            store.open(dir);
+            check_history(store);
+
+            store.wipe();
+            BOOST_CHECK_EQUAL(store.head_block(), 0);
+            BOOST_CHECK_EQUAL(store.get_account_size("alice"), 0);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(undo_block) {
         try {
             fc::temp_directory data_dir(golos::utilities::temp_directory_path());
@@ -213,6 +477,157 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(fork_switch_profile) {
+        try {
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+
+            for (uint32_t depth = 1; depth <= 3; ++depth) {
+                fc::temp_directory data_dir1(golos::utilities::temp_directory_path());
+                fc::temp_directory data_dir2(golos::utilities::temp_directory_path());
+
+                database db1;
+                db1._log_hardforks = false;
+                db1.open(data_dir1.path(), data_dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                database db2;
+                db2._log_hardforks = false;
+                db2.open(data_dir2.path(), data_dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                for (uint32_t i = 0; i < 5; ++i) {
+                    auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                    PUSH_BLOCK(db2, b);
+                }
+                for (uint32_t i = 0; i < depth; ++i) {
+                    db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                }
+                string db1_tip = db1.head_block_id().str();
+
+                uint32_t next_slot = 3;
+                signed_block b;
+                for (uint32_t i = 0; i < depth; ++i) {
+                    b = db2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_witness(next_slot), init_account_priv_key, database::skip_nothing);
+                    next_slot = 1;
+                    PUSH_BLOCK(db1, b);
+                    BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
+                }
+
+                b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                PUSH_BLOCK(db1, b);
+
+                BOOST_CHECK_EQUAL(db1.head_block_id().str(), db2.head_block_id().str());
+
+                auto profile = db1.profiler().get_profile();
+                BOOST_REQUIRE_EQUAL(profile.recent_fork_switches.size(), 1);
+                const auto &fork_switch = profile.recent_fork_switches.back();
+                BOOST_CHECK_EQUAL(fork_switch.undone_blocks, depth);
+                BOOST_CHECK_EQUAL(fork_switch.applied_blocks, depth + 1);
+                BOOST_CHECK_EQUAL(fork_switch.undo_times.size(), depth);
+                BOOST_CHECK_EQUAL(fork_switch.apply_times.size(), depth + 1);
+                BOOST_CHECK(!fork_switch.failed);
+                BOOST_CHECK_EQUAL(profile.max_fork_switch_depth, depth);
+
+                // the old branch is still there to switch back
+                BOOST_CHECK(db1.fetch_block_by_id(block_id_type(db1_tip)).valid());
+            }
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(fork_switch_without_block_cache) {
+        try {
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            fc::temp_directory data_dir1(golos::utilities::temp_directory_path());
+            fc::temp_directory data_dir2(golos::utilities::temp_directory_path());
+
+            database db1;
+            db1._log_hardforks = false;
+            db1.open(data_dir1.path(), data_dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            database db2;
+            db2._log_hardforks = false;
+            db2.open(data_dir2.path(), data_dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+            for (uint32_t i = 0; i < 5; ++i) {
+                auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                PUSH_BLOCK(db2, b);
+            }
+            for (uint32_t i = 0; i < 2; ++i) {
+                db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            }
+            string db1_tip = db1.head_block_id().str();
+
+            uint32_t next_slot = 3;
+            signed_block b;
+            for (uint32_t i = 0; i < 2; ++i) {
+                b = db2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_witness(next_slot), init_account_priv_key, database::skip_nothing);
+                next_slot = 1;
+                PUSH_BLOCK(db1, b);
+                BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
+            }
+
+            // bodies of the fork blocks are held by the fork database, not by the block cache
+            db1.set_block_cache_size(0);
+            BOOST_CHECK_EQUAL(db1.get_block_cache_stats().size, 0);
+
+            b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            PUSH_BLOCK(db1, b);
+            BOOST_CHECK_EQUAL(db1.head_block_id().str(), db2.head_block_id().str());
+            BOOST_CHECK(!db1.profiler().get_profile().recent_fork_switches.back().failed);
+
+            // the old branch can be switched back to
+            BOOST_CHECK(db1.fetch_block_by_id(block_id_type(db1_tip)).valid());
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(block_cache_eviction) {
+        try {
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+
+            std::vector<std::shared_ptr<const signed_block>> blocks;
+            block_id_type previous;
+            for (uint32_t i = 0; i < 4; ++i) {
+                signed_block b;
+                b.previous = previous;
+                b.timestamp = STEEMIT_GENESIS_TIME + STEEMIT_BLOCK_INTERVAL * (i + 1);
+                b.witness = STEEMIT_INIT_MINER_NAME;
+                b.sign(init_account_priv_key);
+                previous = b.id();
+                blocks.push_back(std::make_shared<const signed_block>(b));
+            }
+
+            block_cache cache(3);
+            cache.store(blocks[0], true);
+            cache.store(blocks[1]);
+            cache.store(blocks[2]);
+
+            // block 0 becomes the most recently used one
+            BOOST_CHECK(cache.find_irreversible(blocks[0]->block_num()) == blocks[0]);
+            // block 1 isn't in the block log
+            BOOST_CHECK(!cache.find_irreversible(blocks[1]->block_num()));
+
+            cache.store(blocks[3]);
+            BOOST_CHECK(!cache.find(blocks[1]->id()));
+            BOOST_CHECK(cache.find(blocks[0]->id()) == blocks[0]);
+            BOOST_CHECK(cache.find(blocks[2]->id()) == blocks[2]);
+            BOOST_CHECK(cache.find(blocks[3]->id()) == blocks[3]);
+
+            auto stats = cache.get_stats();
+            BOOST_CHECK_EQUAL(stats.size, 3);
+            BOOST_CHECK_EQUAL(stats.hits, 4);
+            BOOST_CHECK_EQUAL(stats.misses, 2);
+
+            cache.set_max_size(1);
+            BOOST_CHECK_EQUAL(cache.get_stats().size, 1);
+            BOOST_CHECK(cache.find(blocks[3]->id()) == blocks[3]);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(switch_forks_undo_create) {
         try {
             fc::temp_directory dir1(golos::utilities::temp_directory_path()),
@@ -328,6 +743,262 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(recover_block_signatures) {
+        try {
+            fc::temp_directory dir1(golos::utilities::temp_directory_path()),
+                    dir2(golos::utilities::temp_directory_path());
+            database db1,
+                    db2;
+            db1._log_hardforks = false;
+            db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2._log_hardforks = false;
+            db2.open(dir2.path(), dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2.set_signature_recovery_threads(4);
+
+            auto skip_sigs = database::skip_transaction_signatures |
+                             database::skip_authority_check;
+
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = STEEMIT_INIT_MINER_NAME;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration(
+                    db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db1.get_chain_id());
+            PUSH_TX(db1, trx, skip_sigs);
+
+            for (int i = 1; i <= 10; ++i) {
+                trx = decltype(trx)();
+                transfer_operation t;
+                t.from = STEEMIT_INIT_MINER_NAME;
+                t.to = "alice";
+                t.amount = asset(i, STEEM_SYMBOL);
+                trx.operations.push_back(t);
+                trx.set_expiration(
+                        db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                trx.sign(init_account_priv_key, db1.get_chain_id());
+                PUSH_TX(db1, trx, skip_sigs);
+            }
+
+            auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            PUSH_BLOCK(db2, b, database::skip_nothing);
+            BOOST_CHECK(db2.head_block_id() == b.id());
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 55);
+
+            // the transfer signed by a wrong key passes db1 only because it skips signatures
+            trx = decltype(trx)();
+            transfer_operation t;
+            t.from = STEEMIT_INIT_MINER_NAME;
+            t.to = "alice";
+            t.amount = asset(100, STEEM_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration(
+                    db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(database_fixture::generate_private_key("wrong"), db1.get_chain_id());
+            PUSH_TX(db1, trx, skip_sigs);
+
+            b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            STEEMIT_CHECK_THROW(PUSH_BLOCK(db2, b, database::skip_nothing), fc::exception);
+            BOOST_CHECK(db2.head_block_id() == b.previous);
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 55);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(incremental_pending_transactions) {
+        try {
+            fc::temp_directory dir1(golos::utilities::temp_directory_path()),
+                    dir2(golos::utilities::temp_directory_path());
+            database db1,
+                    db2;
+            db1._log_hardforks = false;
+            db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2._log_hardforks = false;
+            db2.open(dir2.path(), dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2.set_incremental_pending(true);
+
+            auto skip_sigs = database::skip_transaction_signatures |
+                             database::skip_authority_check;
+
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+
+            signed_transaction create_trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = STEEMIT_INIT_MINER_NAME;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            create_trx.operations.push_back(cop);
+            create_trx.set_expiration(
+                    db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            create_trx.sign(init_account_priv_key, db1.get_chain_id());
+
+            signed_transaction transfer_trx;
+            transfer_operation t;
+            t.from = STEEMIT_INIT_MINER_NAME;
+            t.to = "alice";
+            t.amount = asset(500, STEEM_SYMBOL);
+            transfer_trx.operations.push_back(t);
+            transfer_trx.set_expiration(
+                    db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            transfer_trx.sign(init_account_priv_key, db1.get_chain_id());
+
+            PUSH_TX(db1, create_trx, skip_sigs);
+            PUSH_TX(db2, create_trx, skip_sigs);
+            PUSH_TX(db2, transfer_trx, skip_sigs);
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 500);
+
+            // the included transaction is dropped, the other one is postponed
+            auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            PUSH_BLOCK(db2, b, skip_sigs);
+            BOOST_CHECK_EQUAL(db2._postponed_tx.size(), 1);
+            BOOST_CHECK(db2._postponed_tx.front().id() == transfer_trx.id());
+            BOOST_CHECK(db2.is_known_transaction(create_trx.id()));
+            BOOST_CHECK(!db2.is_known_transaction(transfer_trx.id()));
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 0);
+
+            BOOST_CHECK_EQUAL(db2.apply_postponed_transactions(fc::seconds(10)), 0);
+            BOOST_CHECK(db2._postponed_tx.empty());
+            BOOST_CHECK(db2.is_known_transaction(transfer_trx.id()));
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 500);
+
+            // postponed transactions are included into generated blocks without being re-applied first
+            b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            PUSH_BLOCK(db2, b, skip_sigs);
+            BOOST_CHECK_EQUAL(db2._postponed_tx.size(), 1);
+            b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            BOOST_CHECK_EQUAL(b.transactions.size(), 1);
+            BOOST_CHECK(db2._postponed_tx.empty());
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 500);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(state_snapshot_export_import) {
+        try {
+            fc::temp_directory dir1(golos::utilities::temp_directory_path()),
+                    dir2(golos::utilities::temp_directory_path());
+            auto snapshot = dir1.path() / "state.snapshot";
+            auto skip_sigs = database::skip_transaction_signatures |
+                             database::skip_authority_check;
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+
+            uint32_t head_block_num = 0;
+            size_t accounts = 0;
+            {
+                database db1;
+                db1._log_hardforks = false;
+                db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                signed_transaction trx;
+                account_create_operation cop;
+                cop.new_account_name = "alice";
+                cop.creator = STEEMIT_INIT_MINER_NAME;
+                cop.owner = authority(1, init_account_priv_key.get_public_key(), 1);
+                cop.active = cop.owner;
+                trx.operations.push_back(cop);
+                transfer_operation t;
+                t.from = STEEMIT_INIT_MINER_NAME;
+                t.to = "alice";
+                t.amount = asset(500, STEEM_SYMBOL);
+                trx.operations.push_back(t);
+                trx.set_expiration(db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                trx.sign(init_account_priv_key, db1.get_chain_id());
+                PUSH_TX(db1, trx, skip_sigs);
+
+                for (uint32_t i = 0; i < 10; ++i) {
+                    db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+                }
+                db1.close();
+
+                // reopened state is at the last irreversible block
+                db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                head_block_num = db1.head_block_num();
+                accounts = db1.get_index<account_index>().indices().size();
+                BOOST_CHECK_EQUAL(db1.get_balance("alice", STEEM_SYMBOL).amount.value, 500);
+
+                // removed votes leave gaps in ids: after a vote with the default keys and at the tail
+                db1.with_write_lock([&]() {
+                    BOOST_REQUIRE(db1.get_index<comment_vote_index>().indices().empty());
+                    db1.create<comment_vote_object>([](comment_vote_object &) {});
+                    db1.remove(db1.create<comment_vote_object>([](comment_vote_object &v) {
+                        v.voter = account_id_type(1);
+                    }));
+                    db1.create<comment_vote_object>([](comment_vote_object &v) {
+                        v.voter = account_id_type(2);
+                        v.rshares = 100;
+                    });
+                    db1.remove(db1.create<comment_vote_object>([](comment_vote_object &v) {
+                        v.voter = account_id_type(3);
+                    }));
+                });
+
+                db1.export_state(snapshot);
+                db1.close();
+            }
+
+            fc::copy(dir1.path() / "block_log", dir2.path() / "block_log");
+            fc::copy(dir1.path() / "block_log.index", dir2.path() / "block_log.index");
+
+            database db2;
+            db2._log_hardforks = false;
+            db2.import_state(dir2.path(), dir2.path(), TEST_SHARED_MEM_SIZE, snapshot);
+            BOOST_CHECK_GE(db2.head_block_num(), head_block_num);
+            BOOST_CHECK_EQUAL(db2.get_index<account_index>().indices().size(), accounts);
+            BOOST_CHECK_EQUAL(db2.get_balance("alice", STEEM_SYMBOL).amount.value, 500);
+            BOOST_CHECK(db2.get<account_authority_object, by_account>("alice").owner ==
+                        authority(1, init_account_priv_key.get_public_key(), 1));
+
+            // objects keep their ids and ids of the removed objects aren't reused
+            const auto &votes = db2.get_index<comment_vote_index>().indices();
+            BOOST_REQUIRE_EQUAL(votes.size(), 2);
+            BOOST_CHECK_EQUAL(votes.begin()->id._id, 0);
+            BOOST_CHECK_EQUAL(votes.rbegin()->id._id, 2);
+            BOOST_CHECK(votes.rbegin()->voter == account_id_type(2));
+            BOOST_CHECK_EQUAL(votes.rbegin()->rshares, 100);
+            BOOST_CHECK_EQUAL(db2.get_index<comment_vote_index>().get_next_id(), 4);
+
+            // the imported node keeps producing blocks and creating objects
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "bob";
+            cop.creator = STEEMIT_INIT_MINER_NAME;
+            cop.owner = authority(1, init_account_priv_key.get_public_key(), 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration(db2.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db2.get_chain_id());
+            PUSH_TX(db2, trx, skip_sigs);
+            db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key, skip_sigs);
+            BOOST_CHECK(db2.find_account("bob") != nullptr);
+            db2.close();
+
+            // corrupted snapshots are rejected
+            {
+                std::fstream file(snapshot.generic_string(), std::ios::in | std::ios::out | std::ios::binary);
+                file.seekp(-1, std::ios::end);
+                file.put('x');
+            }
+            database db3;
+            db3._log_hardforks = false;
+            BOOST_CHECK_THROW(db3.import_state(dir2.path(), dir2.path(), TEST_SHARED_MEM_SIZE, snapshot), fc::exception);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(tapos) {
         try {
             fc::temp_directory dir1(golos::utilities::temp_directory_path());
@@ -691,6 +1362,221 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         FC_LOG_AND_RETHROW();
     }
 
+    BOOST_FIXTURE_TEST_CASE(block_profile, clean_database_fixture) {
+        try {
+            auto &profiler = db->profiler();
+            BOOST_CHECK(!profiler.enabled());
+            generate_block();
+            BOOST_CHECK_EQUAL(profiler.get_profile().blocks.count, 0);
+
+            profiler.enable(true);
+            account_create("alice", generate_private_key("alice").get_public_key());
+            generate_block();
+            generate_block();
+
+            auto profile = profiler.get_profile();
+            BOOST_CHECK_EQUAL(profile.blocks.count, 2);
+            BOOST_CHECK_EQUAL(profile.stages["process_funds"].count, 2);
+            BOOST_CHECK_EQUAL(profile.stages["validate_block_header"].count, 2);
+            // update_virtual_supply runs twice per block, each call is a stage of its own
+            BOOST_CHECK_EQUAL(profile.stages["update_virtual_supply"].count, 2);
+            BOOST_CHECK_EQUAL(profile.stages["update_virtual_supply_after_rewards"].count, 2);
+            BOOST_CHECK_EQUAL(profile.signals["applied_block"].count, 2);
+            BOOST_CHECK(profile.signals["pre_apply_operation"].count > 0);
+
+            // the operation is applied as a pending transaction, while generating the block and inside the block
+            auto &op = profile.operations["account_create"];
+            BOOST_CHECK_EQUAL(op.count, 3);
+            BOOST_REQUIRE_EQUAL(op.buckets.size(), profile_histogram::bucket_count);
+            uint64_t bucket_sum = 0;
+            for (auto bucket : op.buckets) {
+                bucket_sum += bucket;
+            }
+            BOOST_CHECK_EQUAL(bucket_sum, op.count);
+
+            profiler.reset();
+            BOOST_CHECK_EQUAL(profiler.get_profile().blocks.count, 0);
+            BOOST_CHECK(profiler.get_profile().operations.empty());
+            profiler.enable(false);
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
+    BOOST_FIXTURE_TEST_CASE(signal_handler_profile, clean_database_fixture) {
+        try {
+            auto &profiler = db->profiler();
+            uint32_t calls = 0;
+            auto connection = db->connect_applied_block("test", [&](const signed_block &) {
+                ++calls;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            });
+
+            auto find_handler = [&]() {
+                for (const auto &handler : profiler.get_signal_handlers()) {
+                    if (handler.plugin == "test") {
+                        return handler;
+                    }
+                }
+                BOOST_FAIL("handler is not registered");
+                return signal_handler_profile();
+            };
+
+            // handlers are called but not timed while the profiler is disabled
+            generate_block();
+            BOOST_CHECK_EQUAL(calls, 1);
+            BOOST_CHECK_EQUAL(find_handler().count, 0);
+
+            profiler.set_slow_handler_threshold(fc::milliseconds(1));
+            profiler.enable(true);
+            generate_block();
+            generate_block();
+
+            auto handler = find_handler();
+            BOOST_CHECK_EQUAL(calls, 3);
+            BOOST_CHECK_EQUAL(handler.signal, "applied_block");
+            BOOST_CHECK_EQUAL(handler.count, 2);
+            BOOST_CHECK_EQUAL(handler.slow_count, 2);
+            BOOST_CHECK(handler.total_time >= 4000);
+
+            profiler.reset();
+            BOOST_CHECK_EQUAL(find_handler().count, 0);
+
+            profiler.enable(false);
+            profiler.set_slow_handler_threshold(fc::microseconds());
+            connection.disconnect();
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
+    BOOST_FIXTURE_TEST_CASE(async_indexing, clean_database_fixture) {
+        try {
+            ACTORS((alice))
+            generate_block();
+
+            // a plugin which hasn't allowed async indexing is rejected
+            db->set_async_indexing({"test", "other"}, 1000, 2);
+            BOOST_CHECK(!db->is_async_indexing("test"));
+            STEEMIT_REQUIRE_THROW(db->start_async_indexing(), fc::exception);
+
+            db->set_async_indexing({"test"}, 1000, 2);
+            db->allow_async_indexing("test");
+            BOOST_CHECK(db->is_async_indexing("test"));
+            uint32_t transfers = 0;
+            uint32_t wrong_times = 0;
+            std::vector<uint32_t> blocks;
+            auto op_connection = db->connect_post_apply_operation("test", [&](const operation_notification &note) {
+                if (note.op.which() == operation::tag<transfer_operation>::value) {
+                    ++transfers;
+                }
+            });
+            auto block_connection = db->connect_applied_block("test", [&](const signed_block &b) {
+                blocks.push_back(b.block_num());
+                // the head can be ahead of the block, the notification time is the time of the block
+                if (db->notification_time() != b.timestamp) {
+                    ++wrong_times;
+                }
+            });
+
+            // operations of pending transactions are not indexed
+            transfer(STEEMIT_INIT_MINER_NAME, "alice", 1000);
+            BOOST_CHECK_EQUAL(transfers, 0);
+
+            // without the indexing thread blocks are indexed right after they are applied
+            generate_block();
+            BOOST_CHECK_EQUAL(transfers, 1);
+            BOOST_REQUIRE_EQUAL(blocks.size(), 1);
+            BOOST_CHECK_EQUAL(blocks.back(), db->head_block_num());
+
+            // the indexing thread keeps the order, the rest of the queue is indexed when it stops
+            db->start_async_indexing();
+            generate_blocks(5);
+            db->stop_async_indexing();
+            BOOST_REQUIRE_EQUAL(blocks.size(), 6);
+            for (size_t i = 1; i < blocks.size(); ++i) {
+                BOOST_CHECK_EQUAL(blocks[i], blocks[i - 1] + 1);
+            }
+            BOOST_CHECK_EQUAL(blocks.back(), db->head_block_num());
+            BOOST_CHECK_EQUAL(wrong_times, 0);
+
+            op_connection.disconnect();
+            block_connection.disconnect();
+            db->set_async_indexing({}, 1000, 100);
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
+    BOOST_FIXTURE_TEST_CASE(indexing_queue_handler_failure, clean_database_fixture) {
+        try {
+            generate_block();
+            auto b = *db->fetch_block_by_number(db->head_block_num());
+
+            indexing_queue queue;
+            std::vector<int64_t> amounts;
+            uint32_t blocks = 0;
+            queue.post_apply_operation.connect([&](const operation_notification &note) {
+                auto amount = note.op.get<transfer_operation>().amount.amount.value;
+                if (amount == 1) {
+                    FC_THROW("Handler fails on the first operation");
+                }
+                amounts.push_back(amount);
+            });
+            queue.applied_block.connect([&](const signed_block &) {
+                ++blocks;
+                throw std::runtime_error("Handler fails on the block");
+            });
+
+            transfer_operation op;
+            op.amount = asset(1, STEEM_SYMBOL);
+            queue.add_operation(true, operation_notification(op), b.timestamp);
+            op.amount = asset(2, STEEM_SYMBOL);
+            queue.add_operation(true, operation_notification(op), b.timestamp);
+            queue.add_block(b);
+
+            // the failed notification doesn't skip the rest of the block
+            BOOST_CHECK_EQUAL(queue.dispatch(b.block_num(), 0, 10), 1);
+            BOOST_CHECK(amounts == std::vector<int64_t>({2}));
+            BOOST_CHECK_EQUAL(blocks, 1);
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
+    BOOST_FIXTURE_TEST_CASE(indexing_queue_pop_block, clean_database_fixture) {
+        try {
+            generate_blocks(2);
+            auto b1 = *db->fetch_block_by_number(db->head_block_num() - 1);
+            auto b2 = *db->fetch_block_by_number(db->head_block_num());
+
+            indexing_queue queue;
+            std::vector<uint32_t> blocks;
+            queue.applied_block.connect([&](const signed_block &b) {
+                blocks.push_back(b.block_num());
+            });
+
+            queue.add_block(b1);
+            queue.add_block(b2);
+
+            // b1 is dispatched while b2 is the head
+            BOOST_CHECK_EQUAL(queue.dispatch(b2.block_num(), 0, 1), 1);
+            BOOST_CHECK_EQUAL(queue.size(), 1);
+
+            // popping b2 reverts what was written for b1, so b1 is queued again and b2 is dropped
+            queue.pop_block(b2.block_num());
+            BOOST_CHECK_EQUAL(queue.size(), 1);
+            BOOST_CHECK_EQUAL(queue.dispatch(b1.block_num(), 0, 10), 1);
+            BOOST_CHECK_EQUAL(queue.size(), 0);
+
+            // irreversible blocks are forgotten after dispatch
+            queue.add_block(b2);
+            BOOST_CHECK_EQUAL(queue.dispatch(b2.block_num(), b2.block_num(), 10), 1);
+            queue.pop_block(b2.block_num());
+            BOOST_CHECK_EQUAL(queue.size(), 0);
+
+            std::vector<uint32_t> expected = {b1.block_num(), b1.block_num(), b2.block_num()};
+            BOOST_CHECK(blocks == expected);
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
     BOOST_FIXTURE_TEST_CASE(hardfork_test, database_fixture) {
         try {
             try {